@@ -0,0 +1,44 @@
+#version 330 core
+
+// Vertex inputs: the particle at the two most recent physics steps
+layout(location = 0) in vec3 aPos0;   // older step
+layout(location = 1) in vec3 aColor;  // particle color (static, uploaded once)
+layout(location = 2) in vec3 aVel0;
+layout(location = 3) in vec3 aPos1;   // newer step
+layout(location = 4) in vec3 aVel1;
+
+// Uniforms
+uniform mat4 uMVP;        // projection * view * model (model = identity here)
+uniform vec3 uCamPos;     // camera position (world)
+uniform float uPointSize; // base size in pixels
+uniform int uColorMode;   // 0: per-particle color, 1: by distance from the origin
+uniform float uColorRadius; // radius the distance ramp spans
+uniform float uBlend;     // 0: older step, 1: newer step
+uniform float uStepTime;  // simulated time between the two steps
+
+// Varyings
+out vec3 vColor;
+
+void main() {
+    // Cubic Hermite between the steps, with the velocities as tangents: the
+    // path is smooth across steps and follows the orbit's curvature
+    float s = uBlend;
+    float s2 = s * s;
+    float s3 = s2 * s;
+    vec3 pos = (2.0 * s3 - 3.0 * s2 + 1.0) * aPos0 + (s3 - 2.0 * s2 + s) * uStepTime * aVel0 +
+               (3.0 * s2 - 2.0 * s3) * aPos1 + (s3 - s2) * uStepTime * aVel1;
+    gl_Position = uMVP * vec4(pos, 1.0);
+
+    // Approximate distance-based size attenuation in world space
+    float dist = length(uCamPos - pos);
+    float size = uPointSize / (0.06 * dist + 1.0);
+    gl_PointSize = clamp(size, 1.0, 12.0);
+
+    if (uColorMode == 1) {
+        // Warm core to blue outskirts
+        float t = clamp(length(pos) / uColorRadius, 0.0, 1.0);
+        vColor = mix(vec3(1.0, 0.85, 0.6), vec3(0.35, 0.55, 1.0), t);
+    } else {
+        vColor = aColor;
+    }
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+in vec3 vColor;      // from lod.vert (already scaled for splats)
+flat in int vSplat;  // 1: an aggregated tile, 0: a single particle
+out vec4 FragColor;
+
+void main() {
+    vec2 p = gl_PointCoord - vec2(0.5);
+    float r = length(p);
+    if (r > 0.5) discard;
+
+    if (vSplat == 0) {
+        // Single particle: same glow as particle.frag
+        float sigma = 0.20;
+        float intensity = exp(-(r*r) / (2.0 * sigma * sigma));
+        vec3 col = vColor * (0.6 + 0.4 * intensity);
+        FragColor = vec4(col * intensity, intensity);
+        return;
+    }
+
+    // Tile splat: a wide Gaussian (sigma = half a tile) so neighbouring splats blend into a
+    // smooth field; lod.vert normalized vColor so the splat adds up to its particles' light
+    float sigma = 1.0 / 6.0;
+    FragColor = vec4(vColor * exp(-(r*r) / (2.0 * sigma * sigma)), 1.0);
+}
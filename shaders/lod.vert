@@ -0,0 +1,45 @@
+#version 330 core
+
+// Vertex inputs (LodVertex, src/lod.h)
+layout(location = 0) in vec3 aPos;   // particle position, or a tile's mass-weighted centroid
+layout(location = 1) in vec3 aColor; // RGBA8 color (alpha unused)
+layout(location = 2) in vec2 aSplat; // x: splat size in pixels (0 = single particle), y: summed sprite area
+
+// Uniforms
+uniform mat4 uMVP;        // projection * view
+uniform vec3 uCamPos;     // camera position (world)
+uniform float uPointSize; // base size in pixels of a single particle
+uniform int uColorMode;   // 0: per-particle color, 1: by distance from the origin
+uniform float uColorRadius; // radius the distance ramp spans
+
+// Varyings
+out vec3 vColor;
+flat out int vSplat;
+
+// Light of one particle.frag sprite per pixel^2 of its size (integral of
+// (0.6 + 0.4 I) I^2 over the disc), and of one lod.frag splat
+const float kSpriteLight = 0.10876;
+const float kSplatLight = 0.17259;
+
+void main() {
+    gl_Position = uMVP * vec4(aPos, 1.0);
+
+    vec3 color = aColor;
+    if (uColorMode == 1) {
+        float t = clamp(length(aPos) / uColorRadius, 0.0, 1.0);
+        color = mix(vec3(1.0, 0.85, 0.6), vec3(0.35, 0.55, 1.0), t);
+    }
+
+    if (aSplat.x <= 0.0) {
+        // Near the camera: exactly as particle.vert
+        float dist = length(uCamPos - aPos);
+        gl_PointSize = clamp(uPointSize / (0.06 * dist + 1.0), 1.0, 12.0);
+        vColor = color;
+        vSplat = 0;
+    } else {
+        // A tile: the light of all its particles spread over one larger sprite
+        gl_PointSize = aSplat.x;
+        vColor = color * (aSplat.y * kSpriteLight / (kSplatLight * aSplat.x * aSplat.x));
+        vSplat = 1;
+    }
+}
@@ -1,25 +1,43 @@
 #version 330 core
 
 // Vertex inputs
-layout(location = 0) in vec3 aPos;    // particle position (world)
-layout(location = 1) in vec3 aColor;  // particle color
+layout(location = 0) in vec3 aPos;    // particle position, normalized inside the frame's box
+layout(location = 1) in vec3 aColor;  // particle color (static, uploaded once)
 
 // Uniforms
 uniform mat4 uMVP;        // projection * view * model (model = identity here)
 uniform vec3 uCamPos;     // camera position (world)
 uniform float uPointSize; // base size in pixels
+uniform vec3 uBoxOrigin;  // world position of aPos = 0
+uniform vec3 uBoxExtent;  // world size of the box
+uniform int uColorMode;   // 0: per-particle color, 1: by distance from the origin
+uniform float uColorRadius; // radius the distance ramp spans
+uniform float uSampleScale; // particles each drawn one stands for (1: all are drawn)
 
 // Varyings
 out vec3 vColor;
 
 void main() {
-    // Project to clip space
-    gl_Position = uMVP * vec4(aPos, 1.0);
+    // Back to world space, then project to clip space
+    vec3 pos = uBoxOrigin + aPos * uBoxExtent;
+    gl_Position = uMVP * vec4(pos, 1.0);
 
     // Approximate distance-based size attenuation in world space
-    float dist = length(uCamPos - aPos);
-    float size = uPointSize / (0.06 * dist + 1.0);
-    gl_PointSize = clamp(size, 1.0, 12.0);
+    float dist = length(uCamPos - pos);
+    float size = clamp(uPointSize / (0.06 * dist + 1.0), 1.0, 12.0);
 
-    vColor = aColor;
+    // Subsampled preview: widen the sprite to cover the light of the particles it stands for,
+    // and brighten it by whatever area the size limit cuts off
+    float drawn = min(size * sqrt(uSampleScale), 12.0);
+    gl_PointSize = drawn;
+    float gain = uSampleScale * (size * size) / (drawn * drawn);
+
+    if (uColorMode == 1) {
+        // Warm core to blue outskirts
+        float t = clamp(length(pos) / uColorRadius, 0.0, 1.0);
+        vColor = mix(vec3(1.0, 0.85, 0.6), vec3(0.35, 0.55, 1.0), t);
+    } else {
+        vColor = aColor;
+    }
+    vColor *= gain;
 }
\ No newline at end of file
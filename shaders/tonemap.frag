@@ -0,0 +1,10 @@
+#version 330 core
+
+uniform sampler2D uHdr;   // summed light of the additive particle pass (RGBA16F)
+uniform float uExposure;  // 1 - exp(-uExposure * c): linear for faint pixels, never clips
+out vec4 FragColor;
+
+void main() {
+    vec3 c = texelFetch(uHdr, ivec2(gl_FragCoord.xy), 0).rgb;
+    FragColor = vec4(1.0 - exp(-uExposure * c), 1.0);
+}
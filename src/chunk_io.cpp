@@ -0,0 +1,266 @@
+#include "chunk_io.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define NBODY_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace {
+
+// pwrite/pread fallback: one buffer, every transfer completes before returning
+class SyncQueue : public ChunkQueue {
+public:
+    explicit SyncQueue(size_t chunkBytes) { chunk.buf.allocate(chunkBytes); }
+
+    bool open(const char* path, bool write, bool direct) override {
+        writing = write;
+        failed = !(write ? file.openWrite(path, direct) : file.openRead(path, direct));
+        return !failed;
+    }
+    IOChunk* acquire() override { return failed ? nullptr : &chunk; }
+    bool write(IOChunk* c) override {
+        if (!failed && !file.writeAt(c->buf.data, c->bytes, c->offset)) failed = true;
+        return !failed;
+    }
+    bool read(IOChunk* c) override {
+        if (!failed && !file.readAt(c->buf.data, c->bytes, c->offset)) failed = true;
+        if (!failed && onRead) onRead(*c);
+        return !failed;
+    }
+    bool drain() override { return !failed; }
+    bool finish() override {
+        bool ok = !failed;
+        if (writing) ok = file.sync() && ok;
+        ok = file.close() && ok;
+        return ok;
+    }
+    const char* name() const override { return "pwrite"; }
+
+private:
+    BlockFile file;
+    IOChunk chunk;
+    bool writing = false;
+    bool failed = false;
+};
+
+#ifdef NBODY_IO_URING
+
+// io_uring through the raw syscalls (no liburing dependency). One submission
+// queue entry per chunk; the rings are sized so the SQ can never overflow.
+class UringQueue : public ChunkQueue {
+public:
+    UringQueue(size_t chunkBytes, unsigned depth)
+        : chunks(new IOChunk[depth]), iov(depth), done(depth), reading(depth), count(depth) {
+        for (unsigned i = 0; i < depth; ++i) {
+            chunks[i].buf.allocate(chunkBytes);
+            freeList.push_back(&chunks[i]);
+        }
+    }
+
+    ~UringQueue() override {
+        // The kernel may still be touching our buffers
+        if (ringFd >= 0) drain();
+        if (sqes) munmap(sqes, sqesBytes);
+        if (cqRing && cqRing != sqRing) munmap(cqRing, cqBytes);
+        if (sqRing) munmap(sqRing, sqBytes);
+        if (ringFd >= 0) ::close(ringFd);
+    }
+
+    // Create and map the rings; false (errno set) if io_uring is unavailable
+    bool setup() {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        int fd = (int)syscall(__NR_io_uring_setup, count, &p);
+        if (fd < 0) return false;
+        ringFd = fd;
+
+        sqBytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cqBytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) sqBytes = cqBytes = (sqBytes > cqBytes ? sqBytes : cqBytes);
+
+        sqRing = mapRing(sqBytes, IORING_OFF_SQ_RING);
+        cqRing = single ? sqRing : mapRing(cqBytes, IORING_OFF_CQ_RING);
+        sqesBytes = p.sq_entries * sizeof(io_uring_sqe);
+        void* s = mapRing(sqesBytes, IORING_OFF_SQES);
+        if (!sqRing || !cqRing || !s) return false;
+        sqes = static_cast<io_uring_sqe*>(s);
+
+        unsigned char* sq = static_cast<unsigned char*>(sqRing);
+        unsigned char* cq = static_cast<unsigned char*>(cqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    bool open(const char* path, bool write, bool direct) override {
+        drain();
+        writing = write;
+        failed = !(write ? file.openWrite(path, direct) : file.openRead(path, direct));
+        return !failed;
+    }
+
+    IOChunk* acquire() override {
+        while (!failed && freeList.empty())
+            if (!reap()) break;
+        if (failed) return nullptr;
+        IOChunk* c = freeList.back();
+        freeList.pop_back();
+        return c;
+    }
+
+    bool write(IOChunk* c) override { return start(c, false); }
+    bool read(IOChunk* c) override { return start(c, true); }
+
+    bool drain() override {
+        while (inflight > 0)
+            if (!reap()) break;
+        return !failed;
+    }
+
+    bool finish() override {
+        bool ok = drain();
+        if (writing) ok = file.sync() && ok;
+        ok = file.close() && ok;
+        return ok;
+    }
+
+    const char* name() const override { return "io_uring"; }
+
+private:
+    void* mapRing(size_t bytes, unsigned long long offset) {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, (off_t)offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        for (;;) {
+            int r = (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0);
+            if (r >= 0 || errno != EINTR) return r;
+        }
+    }
+
+    bool start(IOChunk* c, bool isRead) {
+        if (failed) return false;
+        const unsigned i = (unsigned)(c - chunks.get());
+        done[i] = 0;
+        reading[i] = isRead;
+        return push(i);
+    }
+
+    // Queue the outstanding part of chunk i and submit it
+    bool push(unsigned i) {
+        IOChunk& c = chunks[i];
+        iov[i].iov_base = c.buf.data + done[i];
+        iov[i].iov_len = c.bytes - done[i];
+
+        const unsigned tail = *sqTail; // we are the only producer
+        const unsigned slot = tail & sqMask;
+        io_uring_sqe& sqe = sqes[slot];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = reading[i] ? IORING_OP_READV : IORING_OP_WRITEV;
+        sqe.fd = file.nativeHandle();
+        sqe.addr = (uint64_t)(uintptr_t)&iov[i];
+        sqe.len = 1;
+        sqe.off = c.offset + done[i];
+        sqe.user_data = i;
+        sqArray[slot] = slot;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        if (enter(1, 0, 0) < 0) {
+            std::cerr << "io_uring submit failed: " << std::strerror(errno) << std::endl;
+            failed = true;
+            return false;
+        }
+        ++inflight;
+        return true;
+    }
+
+    // Wait for one completion: resubmit a short transfer, else release the chunk
+    bool reap() {
+        unsigned head = *cqHead;
+        while (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0) {
+                std::cerr << "io_uring wait failed: " << std::strerror(errno) << std::endl;
+                failed = true;
+                return false;
+            }
+        }
+        const io_uring_cqe cqe = cqes[head & cqMask];
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        --inflight;
+
+        const unsigned i = (unsigned)cqe.user_data;
+        IOChunk& c = chunks[i];
+        if (cqe.res <= 0) {
+            if (!failed)
+                std::cerr << "io_uring " << (reading[i] ? "read" : "write") << " failed at offset " << c.offset
+                          << ": " << (cqe.res < 0 ? std::strerror(-cqe.res) : "unexpected end of file") << std::endl;
+            failed = true;
+        } else {
+            done[i] += (size_t)cqe.res;
+            if (done[i] < c.bytes && !failed) return push(i);
+            if (reading[i] && !failed && onRead) onRead(c);
+        }
+        freeList.push_back(&c);
+        return true;
+    }
+
+    std::unique_ptr<IOChunk[]> chunks;
+    std::vector<iovec> iov;
+    std::vector<size_t> done;      // bytes transferred so far, per chunk
+    std::vector<bool> reading;
+    std::vector<IOChunk*> freeList;
+    unsigned count;
+    unsigned inflight = 0;
+
+    BlockFile file;
+    bool writing = false;
+    bool failed = false;
+
+    int ringFd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqBytes = 0, cqBytes = 0, sqesBytes = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+};
+
+#endif
+
+} // namespace
+
+std::unique_ptr<ChunkQueue> makeChunkQueue(IOBackend backend, size_t chunkBytes, unsigned depth) {
+    if (backend == IOBackend::IoUring) {
+#ifdef NBODY_IO_URING
+        auto q = std::make_unique<UringQueue>(chunkBytes, depth < 1 ? 1 : depth);
+        if (q->setup()) return q;
+        std::cerr << "io_uring unavailable (" << std::strerror(errno) << "), using pwrite" << std::endl;
+#else
+        std::cerr << "io_uring not supported on this platform, using pwrite" << std::endl;
+#endif
+    }
+    return std::make_unique<SyncQueue>(chunkBytes);
+}
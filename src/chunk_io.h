@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "file_io.h"
+
+// How chunked snapshot transfers are issued
+enum class IOBackend {
+    Sync,    // one pwrite/pread at a time on the calling thread
+    IoUring, // up to `depth` transfers in flight through io_uring (Linux)
+};
+
+// A staging buffer and the transfer it carries
+struct IOChunk {
+    AlignedBuffer buf;
+    size_t bytes = 0;    // transfer length (whole pages under direct I/O)
+    uint64_t offset = 0; // file offset
+};
+
+// Chunked positional I/O on one file.
+//
+// The caller acquire()s a staging buffer, fills it (or just sets bytes/offset
+// for a read) and hands it to write()/read(). With the io_uring backend the
+// transfer is only queued, so the caller can transpose the next chunk while
+// earlier ones are still on their way to the device; acquire() blocks only
+// when every buffer is in flight. Reads report through onRead as they land,
+// in completion order. The first failure is sticky: later calls return
+// false / nullptr.
+class ChunkQueue {
+public:
+    virtual ~ChunkQueue() = default;
+
+    virtual bool open(const char* path, bool write, bool direct) = 0;
+    virtual IOChunk* acquire() = 0;
+    virtual bool write(IOChunk* chunk) = 0;
+    virtual bool read(IOChunk* chunk) = 0;
+    virtual bool drain() = 0;  // wait for everything in flight
+    virtual bool finish() = 0; // drain, sync if writing, close
+    virtual const char* name() const = 0;
+
+    std::function<void(const IOChunk&)> onRead;
+};
+
+// `depth` buffers of `chunkBytes` each. IoUring falls back to Sync (with a
+// message) when the kernel or platform does not provide it.
+std::unique_ptr<ChunkQueue> makeChunkQueue(IOBackend backend, size_t chunkBytes, unsigned depth);
@@ -0,0 +1,205 @@
+#include "culling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <utility>
+
+#include "parallel.h"
+
+static constexpr int kMaxDepth = 10;              // 30-bit Morton keys: 3 bits per level
+static constexpr size_t kMinKeysPerThread = 65536;
+static constexpr size_t kMinLeavesPerThread = 16;
+static constexpr int kRadixBits = 10;             // three passes over the 30-bit keys
+static constexpr size_t kRadixBuckets = size_t(1) << kRadixBits;
+
+// Spread the low 10 bits of x so there are two zero bits between each
+static uint32_t part1by2(uint32_t x) {
+    x &= 0x3ff;
+    x = (x | x << 16) & 0x030000ff;
+    x = (x | x << 8) & 0x0300f00f;
+    x = (x | x << 4) & 0x030c30c3;
+    x = (x | x << 2) & 0x09249249;
+    return x;
+}
+
+// Stable LSD radix sort of (key, index) pairs by key, one fixed slice per thread:
+// each pass counts digits per slice, turns the counts into scatter offsets, then
+// every slice scatters its own elements. Keys start in index order, so equal keys
+// stay in index order, as a full std::sort of the pairs would leave them.
+static void radixSort(std::vector<std::pair<uint32_t, uint32_t>>& keys, std::vector<std::pair<uint32_t, uint32_t>>& tmp) {
+    const size_t n = keys.size();
+    tmp.resize(n);
+    const size_t slices = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(),
+                                                               n / kMinKeysPerThread));
+    const size_t per = (n + slices - 1) / slices;
+    std::vector<size_t> offsets(slices * kRadixBuckets);
+    for (int shift = 0; shift < 3 * kRadixBits; shift += kRadixBits) {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        parallelFor(slices, 1, [&](size_t begin, size_t end) {
+            for (size_t s = begin; s < end; ++s) {
+                size_t* count = &offsets[s * kRadixBuckets];
+                for (size_t i = s * per; i < std::min(n, (s + 1) * per); ++i)
+                    ++count[(keys[i].first >> shift) & (kRadixBuckets - 1)];
+            }
+        });
+        size_t sum = 0;
+        for (size_t d = 0; d < kRadixBuckets; ++d) {
+            for (size_t s = 0; s < slices; ++s) {
+                const size_t c = offsets[s * kRadixBuckets + d];
+                offsets[s * kRadixBuckets + d] = sum;
+                sum += c;
+            }
+        }
+        parallelFor(slices, 1, [&](size_t begin, size_t end) {
+            for (size_t s = begin; s < end; ++s) {
+                size_t* next = &offsets[s * kRadixBuckets];
+                for (size_t i = s * per; i < std::min(n, (s + 1) * per); ++i)
+                    tmp[next[(keys[i].first >> shift) & (kRadixBuckets - 1)]++] = keys[i];
+            }
+        });
+        keys.swap(tmp);
+    }
+}
+
+void CullingOctree::rebuild(const Particle* pts, size_t n, size_t leafSize) {
+    leafSize = std::max<size_t>(leafSize, 1);
+
+    // Per-slice bounds, merged on this thread
+    const size_t slices = std::max<size_t>(1, std::thread::hardware_concurrency());
+    const size_t per = (n + slices - 1) / slices;
+    std::vector<glm::vec3> sliceLo(slices, glm::vec3(INFINITY)), sliceHi(slices, glm::vec3(-INFINITY));
+    parallelFor(slices, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            for (size_t i = s * per; i < std::min(n, (s + 1) * per); ++i) {
+                sliceLo[s] = glm::min(sliceLo[s], pts[i].pos);
+                sliceHi[s] = glm::max(sliceHi[s], pts[i].pos);
+            }
+        }
+    });
+    glm::vec3 lo = sliceLo[0], hi = sliceHi[0];
+    for (size_t s = 1; s < slices; ++s) {
+        lo = glm::min(lo, sliceLo[s]);
+        hi = glm::max(hi, sliceHi[s]);
+    }
+    const glm::vec3 scale = 1023.0f / glm::max(hi - lo, glm::vec3(1e-20f));
+    keys.resize(n);
+    parallelFor(n, kMinKeysPerThread, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec3 q = glm::clamp((pts[i].pos - lo) * scale, glm::vec3(0.0f), glm::vec3(1023.0f));
+            keys[i] = {part1by2((uint32_t)q.x) | part1by2((uint32_t)q.y) << 1 | part1by2((uint32_t)q.z) << 2, (uint32_t)i};
+        }
+    });
+    radixSort(keys, sortScratch);
+    drawOrder.resize(n);
+    parallelFor(n, kMinKeysPerThread, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) drawOrder[i] = keys[i].second;
+    });
+
+    // Split breadth first on the next key digit until a node fits in a leaf
+    nodes.clear();
+    leaves.clear();
+    if (n == 0) return;
+    nodes.push_back(Node{0, (uint32_t)n, 0, 0, lo, hi});
+    std::vector<uint8_t> depth(1, 0);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node node = nodes[i];
+        if (node.count <= leafSize || depth[i] == kMaxDepth) {
+            leaves.push_back((uint32_t)i);
+            continue;
+        }
+        const int shift = 27 - 3 * depth[i];
+        nodes[i].childBegin = (uint32_t)nodes.size();
+        auto it = keys.begin() + node.first;
+        const auto end = it + node.count;
+        while (it != end) {
+            const uint32_t digit = (it->first >> shift) & 7;
+            const auto next = std::partition_point(it, end, [&](const std::pair<uint32_t, uint32_t>& k) {
+                return ((k.first >> shift) & 7) <= digit;
+            });
+            nodes.push_back(Node{(uint32_t)(it - keys.begin()), (uint32_t)(next - it), 0, 0, lo, hi});
+            depth.push_back((uint8_t)(depth[i] + 1));
+            it = next;
+        }
+        nodes[i].childCount = (uint32_t)nodes.size() - nodes[i].childBegin;
+    }
+}
+
+void CullingOctree::cull(const Particle* pts, const glm::mat4& viewProj, CullRanges& out) {
+    out.first.clear();
+    out.count.clear();
+    out.visible = 0;
+    out.lo = glm::vec3(INFINITY);
+    out.hi = glm::vec3(-INFINITY);
+    if (nodes.empty()) return;
+
+    // Leaf bounds from where the particles are now, then parents from their children
+    parallelFor(leaves.size(), kMinLeavesPerThread, [&](size_t begin, size_t end) {
+        for (size_t l = begin; l < end; ++l) {
+            Node& node = nodes[leaves[l]];
+            glm::vec3 lo(INFINITY), hi(-INFINITY);
+            for (uint32_t j = node.first; j < node.first + node.count; ++j) {
+                lo = glm::min(lo, pts[drawOrder[j]].pos);
+                hi = glm::max(hi, pts[drawOrder[j]].pos);
+            }
+            node.lo = lo;
+            node.hi = hi;
+        }
+    });
+    for (size_t i = nodes.size(); i-- > 0;) {
+        Node& node = nodes[i];
+        if (node.childCount == 0) continue;
+        node.lo = nodes[node.childBegin].lo;
+        node.hi = nodes[node.childBegin].hi;
+        for (uint32_t c = 1; c < node.childCount; ++c) {
+            node.lo = glm::min(node.lo, nodes[node.childBegin + c].lo);
+            node.hi = glm::max(node.hi, nodes[node.childBegin + c].hi);
+        }
+    }
+
+    // Frustum planes (a, b, c, d with the inside positive) from the rows of viewProj
+    glm::vec4 planes[6];
+    for (int k = 0; k < 3; ++k) {
+        for (int c = 0; c < 4; ++c) {
+            planes[2 * k][c] = viewProj[c][3] + viewProj[c][k];
+            planes[2 * k + 1][c] = viewProj[c][3] - viewProj[c][k];
+        }
+    }
+
+    // Depth first in child order, so ranges come out sorted and adjacent ones merge
+    auto emit = [&](const Node& node) {
+        if (!out.first.empty() && (uint32_t)(out.first.back() + out.count.back()) == node.first)
+            out.count.back() += (int32_t)node.count;
+        else {
+            out.first.push_back((int32_t)node.first);
+            out.count.push_back((int32_t)node.count);
+        }
+        out.visible += node.count;
+        out.lo = glm::min(out.lo, node.lo);
+        out.hi = glm::max(out.hi, node.hi);
+    };
+    stack.assign(1, 0);
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        bool inside = true, outside = false;
+        for (const glm::vec4& p : planes) {
+            // Box corner farthest along the plane normal, and the nearest one
+            const glm::vec3 far(p.x >= 0 ? node.hi.x : node.lo.x, p.y >= 0 ? node.hi.y : node.lo.y,
+                                p.z >= 0 ? node.hi.z : node.lo.z);
+            const glm::vec3 near(p.x >= 0 ? node.lo.x : node.hi.x, p.y >= 0 ? node.lo.y : node.hi.y,
+                                 p.z >= 0 ? node.lo.z : node.hi.z);
+            if (p.x * far.x + p.y * far.y + p.z * far.z + p.w < 0.0f) {
+                outside = true;
+                break;
+            }
+            if (p.x * near.x + p.y * near.y + p.z * near.z + p.w < 0.0f) inside = false;
+        }
+        if (outside) continue;
+        if (inside || node.childCount == 0) {
+            emit(node);
+            continue;
+        }
+        for (uint32_t c = node.childCount; c-- > 0;) stack.push_back(node.childBegin + c);
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "particle.h"
+
+// Frustum culling for the point renderer.
+//
+// The particles are drawn in a Morton (Z-curve) order, kept as a permutation
+// of the simulation array so that the integrators' particle indices never
+// change. An octree is cut along that order: every node, and so every leaf,
+// is a contiguous range of it. Each frame the leaf bounds are refreshed from
+// the current positions and the tree is walked against the view frustum;
+// nodes wholly inside are taken as one range without visiting their
+// children. Only the visible ranges are packed into the vertex stream and
+// drawn (glMultiDrawArrays), so upload and vertex work follow what is on
+// screen.
+//
+// Particles drift out of Morton order as they move, which loosens the leaf
+// bounds but never makes culling wrong; rebuild() every so often restores
+// tight leaves. It computes bounds and keys on all threads and orders them with
+// a parallel radix sort, so the periodic rebuild does not stall the frame.
+struct CullRanges {
+    std::vector<int32_t> first;  // start of each visible range in order()
+    std::vector<int32_t> count;  // its length (adjacent ranges are merged)
+    size_t visible = 0;          // sum of count
+    glm::vec3 lo{0.0f}, hi{0.0f}; // bounds of the visible particles
+};
+
+class CullingOctree {
+public:
+    // Morton order and tree over pts; leaves hold at most leafSize particles
+    void rebuild(const Particle* pts, size_t n, size_t leafSize);
+
+    // Visible ranges for this frame's positions and view-projection matrix
+    void cull(const Particle* pts, const glm::mat4& viewProj, CullRanges& out);
+
+    const std::vector<uint32_t>& order() const { return drawOrder; } // draw slot -> particle index
+    size_t size() const { return drawOrder.size(); }
+    size_t leafCount() const { return leaves.size(); }
+
+private:
+    struct Node {
+        uint32_t first, count;           // range of drawOrder
+        uint32_t childBegin, childCount; // children are nodes[childBegin, childBegin + childCount)
+        glm::vec3 lo, hi;
+    };
+    std::vector<uint32_t> drawOrder;
+    std::vector<std::pair<uint32_t, uint32_t>> keys, sortScratch; // rebuild: (Morton key, particle), kept between rebuilds
+    std::vector<Node> nodes; // breadth first: children always after their parent
+    std::vector<uint32_t> leaves;
+    std::vector<uint32_t> stack;
+};
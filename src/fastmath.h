@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Branch-free single-precision log / sin / cos (Cephes polynomials).
+// Everything is straight-line arithmetic, bit manipulation and selects, so
+// loops over arrays of inputs vectorize; results are also identical no matter
+// which thread or lane evaluates them. Accuracy is a few ulp, plenty for
+// sampling initial conditions.
+
+static inline uint32_t floatBits(float f) { uint32_t u; std::memcpy(&u, &f, 4); return u; }
+static inline float bitsFloat(uint32_t u) { float f; std::memcpy(&f, &u, 4); return f; }
+
+// Natural log for finite x > 0
+static inline float fastLog(float x) {
+    uint32_t bits = floatBits(x);
+    int e = (int)((bits >> 23) & 0xff) - 126;
+    float m = bitsFloat((bits & 0x007fffffu) | 0x3f000000u); // mantissa in [0.5, 1)
+
+    // Re-centre on 1 so the polynomial works on [sqrt(0.5) - 1, sqrt(2) - 1)
+    bool small = m < 0.707106781186547524f;
+    e -= small ? 1 : 0;
+    float f = small ? m + m - 1.0f : m - 1.0f;
+
+    float z = f * f;
+    float p = 7.0376836292e-2f;
+    p = p * f - 1.1514610310e-1f;
+    p = p * f + 1.1676998740e-1f;
+    p = p * f - 1.2420140846e-1f;
+    p = p * f + 1.4249322787e-1f;
+    p = p * f - 1.6668057665e-1f;
+    p = p * f + 2.0000714765e-1f;
+    p = p * f - 2.4999993993e-1f;
+    p = p * f + 3.3333331174e-1f;
+    float y = p * f * z - 0.5f * z;
+    return f + y + (float)e * 0.693147180559945309f;
+}
+
+// sin and cos together, for moderate |a| (angles of a few turns)
+static inline void fastSinCos(float a, float& s, float& c) {
+    // Quadrant and remainder r in [-pi/4, pi/4] (three-part pi/2 for accuracy)
+    float qf = a * 0.636619772367581343f;
+    int q = (int)(qf + (qf >= 0.0f ? 0.5f : -0.5f));
+    float r = a - (float)q * 1.5703125f;
+    r = r - (float)q * 4.837512969970703125e-4f;
+    r = r - (float)q * 7.54978995489188216e-8f;
+
+    float r2 = r * r;
+    float sr = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+    float cr = 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+
+    int quadrant = q & 3;
+    bool swap = (quadrant & 1) != 0;
+    float sv = swap ? cr : sr;
+    float cv = swap ? sr : cr;
+    s = (quadrant == 2 || quadrant == 3) ? -sv : sv;
+    c = (quadrant == 1 || quadrant == 2) ? -cv : cv;
+}
+
+// exp for x in [-87, 0] (callers clamp). n = round(x / ln 2) comes from the
+// 1.5 * 2^23 rounding trick instead of a float-to-int conversion, so loops
+// calling it vectorize under the default floating-point model. Used per
+// pixel by the software splat renderer.
+static inline float fastExp(float x) {
+    const float shifted = x * 1.44269504088896341f + 12582912.0f; // n sits in the low mantissa bits
+    const float nf = shifted - 12582912.0f;
+    const uint32_t n = floatBits(shifted) - 0x4b400000u;
+    float r = x - nf * 0.693359375f;
+    r = r + nf * 2.12194440e-4f;
+
+    float p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    float y = p * r * r + r + 1.0f;
+    return y * bitsFloat((n + 127u) << 23);
+}
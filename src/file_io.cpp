@@ -0,0 +1,172 @@
+#include "file_io.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static constexpr size_t kPage = 4096;
+
+void AlignedBuffer::allocate(size_t bytes) {
+    release();
+    size = (bytes + kPage - 1) & ~(kPage - 1);
+#ifdef _WIN32
+    data = static_cast<unsigned char*>(_aligned_malloc(size, kPage));
+#else
+    data = static_cast<unsigned char*>(std::aligned_alloc(kPage, size));
+#endif
+    if (data) std::memset(data, 0, size);
+    else size = 0;
+}
+
+void AlignedBuffer::release() {
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    std::free(data);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+bool BlockFile::openWrite(const char* path, bool wantDirect) { return open(path, true, wantDirect); }
+bool BlockFile::openRead(const char* path, bool wantDirect) { return open(path, false, wantDirect); }
+
+#ifdef _WIN32
+
+bool BlockFile::open(const char* path, bool write, bool wantDirect) {
+    close();
+    DWORD access = write ? GENERIC_WRITE : GENERIC_READ;
+    DWORD share = write ? 0 : FILE_SHARE_READ;
+    DWORD disposition = write ? CREATE_ALWAYS : OPEN_EXISTING;
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if (wantDirect) flags |= FILE_FLAG_NO_BUFFERING | (write ? FILE_FLAG_WRITE_THROUGH : 0);
+    HANDLE h = CreateFileA(path, access, share, nullptr, disposition, flags, nullptr);
+    if (h == INVALID_HANDLE_VALUE && wantDirect) {
+        wantDirect = false;
+        h = CreateFileA(path, access, share, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+    if (h == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+    handle = h;
+    direct = wantDirect;
+    return true;
+}
+
+bool BlockFile::writeAt(const void* buf, size_t bytes, uint64_t offset) {
+    const unsigned char* p = static_cast<const unsigned char*>(buf);
+    while (bytes > 0) {
+        DWORD n = (DWORD)(bytes < (1u << 30) ? bytes : (1u << 30));
+        OVERLAPPED ov = {};
+        ov.Offset = (DWORD)offset;
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD done = 0;
+        if (!WriteFile((HANDLE)handle, p, n, &done, &ov) || done == 0) return false;
+        p += done;
+        bytes -= done;
+        offset += done;
+    }
+    return true;
+}
+
+bool BlockFile::readAt(void* buf, size_t bytes, uint64_t offset) {
+    unsigned char* p = static_cast<unsigned char*>(buf);
+    while (bytes > 0) {
+        DWORD n = (DWORD)(bytes < (1u << 30) ? bytes : (1u << 30));
+        OVERLAPPED ov = {};
+        ov.Offset = (DWORD)offset;
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD done = 0;
+        if (!ReadFile((HANDLE)handle, p, n, &done, &ov) || done == 0) return false;
+        p += done;
+        bytes -= done;
+        offset += done;
+    }
+    return true;
+}
+
+bool BlockFile::sync() {
+    return FlushFileBuffers((HANDLE)handle) != 0;
+}
+
+bool BlockFile::close() {
+    bool ok = true;
+    if (handle) ok = CloseHandle((HANDLE)handle) != 0;
+    handle = nullptr;
+    return ok;
+}
+
+#else
+
+bool BlockFile::open(const char* path, bool write, bool wantDirect) {
+    close();
+    int flags = write ? (O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY;
+#ifdef O_DIRECT
+    int f = ::open(path, flags | (wantDirect ? O_DIRECT : 0), 0644);
+    if (f < 0 && wantDirect && errno == EINVAL) {
+        wantDirect = false; // e.g. tmpfs: fall back to buffered I/O
+        f = ::open(path, flags, 0644);
+    }
+#else
+    wantDirect = false;
+    int f = ::open(path, flags, 0644);
+#endif
+    if (f < 0) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+    fd = f;
+    direct = wantDirect;
+    return true;
+}
+
+bool BlockFile::writeAt(const void* buf, size_t bytes, uint64_t offset) {
+    const unsigned char* p = static_cast<const unsigned char*>(buf);
+    while (bytes > 0) {
+        ssize_t n = pwrite(fd, p, bytes, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+bool BlockFile::readAt(void* buf, size_t bytes, uint64_t offset) {
+    unsigned char* p = static_cast<unsigned char*>(buf);
+    while (bytes > 0) {
+        ssize_t n = pread(fd, p, bytes, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+bool BlockFile::sync() {
+    return fsync(fd) == 0;
+}
+
+bool BlockFile::close() {
+    bool ok = true;
+    if (fd >= 0) ok = ::close(fd) == 0;
+    fd = -1;
+    return ok;
+}
+
+#endif
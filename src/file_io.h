@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Page-aligned heap buffer, as required for unbuffered (O_DIRECT) I/O
+struct AlignedBuffer {
+    unsigned char* data = nullptr;
+    size_t size = 0;
+
+    AlignedBuffer() = default;
+    explicit AlignedBuffer(size_t bytes) { allocate(bytes); }
+    ~AlignedBuffer() { release(); }
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    void allocate(size_t bytes); // rounds up to 4096, contents zeroed
+    void release();
+};
+
+// Positional reads/writes on a file. With `direct` the OS page cache is
+// bypassed (O_DIRECT / FILE_FLAG_NO_BUFFERING); every transfer must then be
+// 4096-aligned in offset, length and memory. If the filesystem refuses
+// direct I/O the file is silently reopened buffered.
+struct BlockFile {
+    BlockFile() = default;
+    ~BlockFile() { close(); }
+    BlockFile(const BlockFile&) = delete;
+    BlockFile& operator=(const BlockFile&) = delete;
+
+    bool openWrite(const char* path, bool direct); // create / truncate
+    bool openRead(const char* path, bool direct);
+    bool writeAt(const void* buf, size_t bytes, uint64_t offset);
+    bool readAt(void* buf, size_t bytes, uint64_t offset); // false on error or early EOF
+    bool sync();   // flush data to stable storage
+    bool close();  // false if the handle could not be closed cleanly
+    bool isDirect() const { return direct; }
+#ifndef _WIN32
+    int nativeHandle() const { return fd; } // for io_uring submissions
+#endif
+
+private:
+    bool open(const char* path, bool write, bool direct);
+
+    bool direct = false;
+#ifdef _WIN32
+    void* handle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
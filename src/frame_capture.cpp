@@ -0,0 +1,175 @@
+#include "frame_capture.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "png_writer.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+bool FrameCapture::open(const std::string& target, int width, int height, int fps) {
+    close();
+    w = width;
+    h = height;
+    if (w <= 0 || h <= 0) return false;
+    directory.clear();
+    if (target.compare(0, 7, "ffmpeg:") == 0) {
+        // Raw RGB frames on ffmpeg's stdin; it picks the codec from the output file's extension
+        const std::string cmd = "ffmpeg -loglevel error -y -f rawvideo -pixel_format rgb24 -video_size " +
+                                std::to_string(w) + "x" + std::to_string(h) + " -framerate " + std::to_string(fps) +
+                                " -i - -pix_fmt yuv420p \"" + target.substr(7) + "\"";
+#ifndef _WIN32
+        std::signal(SIGPIPE, SIG_IGN); // if ffmpeg exits early, writes fail instead of killing the run
+        pipe = popen(cmd.c_str(), "w");
+#else
+        pipe = popen(cmd.c_str(), "wb");
+#endif
+        if (!pipe) {
+            std::cerr << "Cannot start ffmpeg for " << target.substr(7) << std::endl;
+            return false;
+        }
+    } else {
+        std::error_code ec;
+        std::filesystem::create_directories(target, ec);
+        if (ec) {
+            std::cerr << "Cannot create capture directory " << target << ": " << ec.message() << std::endl;
+            return false;
+        }
+        directory = target;
+    }
+
+    glGenBuffers(kSlots, pbos);
+    for (GLuint pbo : pbos) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)w * h * 4, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    issued = released = 0;
+    head = 0;
+    tail = 0;
+    droppedCount = encodedCount = 0;
+    rgb.assign((size_t)w * h * 3, 0);
+    stopping = false;
+    worker = std::thread([this] { run(); });
+    return true;
+}
+
+void FrameCapture::release() {
+    const uint64_t done = tail.load(std::memory_order_acquire);
+    for (; released < done; ++released) {
+        const int slot = (int)(released % kSlots);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        mapped[slot] = nullptr;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameCapture::handOver(bool wait) {
+    for (uint64_t f = head.load(std::memory_order_relaxed); f < issued; ++f) {
+        const int slot = (int)(f % kSlots);
+        const GLenum status = glClientWaitSync(fences[slot], wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                               wait ? 1000000000ull : 0);
+        if (status == GL_TIMEOUT_EXPIRED && !wait) break; // reads land in order
+        glDeleteSync(fences[slot]);
+        fences[slot] = 0;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+        mapped[slot] = static_cast<const uint8_t*>(
+            glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)w * h * 4, GL_MAP_READ_BIT));
+        head.store(f + 1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(mutex); // pairs with the encoder's predicate check
+            wake.notify_one();
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameCapture::capture(int fbWidth, int fbHeight) {
+    if (!isOpen()) return;
+    release();
+    handOver(false);
+    if (fbWidth != w || fbHeight != h || issued - released >= kSlots) {
+        ++droppedCount; // resized, or every PBO is still with the GPU or the encoder
+        return;
+    }
+
+    // Into the PBO: glReadPixels returns at once and the copy happens on the GPU's timeline
+    const int slot = (int)(issued % kSlots);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // RGBA: the path drivers do without conversion
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++issued;
+}
+
+void FrameCapture::close() {
+    if (!worker.joinable()) return;
+    handOver(true);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join(); // encodes everything handed over before returning
+    release();
+    glDeleteBuffers(kSlots, pbos);
+    for (GLuint& pbo : pbos) pbo = 0;
+    if (pipe) {
+        if (pclose(pipe) != 0) std::cerr << "ffmpeg reported an error" << std::endl;
+        pipe = nullptr;
+    }
+    if (droppedCount > 0)
+        std::cerr << "Frame capture dropped " << droppedCount << " frames (encoder behind, or window resized)"
+                  << std::endl;
+}
+
+void FrameCapture::run() {
+    for (;;) {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(500), [this] {
+                return stopping || head.load(std::memory_order_acquire) > tail.load(std::memory_order_relaxed);
+            });
+            stop = stopping;
+        }
+
+        const uint64_t hd = head.load(std::memory_order_acquire);
+        for (uint64_t f = tail.load(std::memory_order_relaxed); f < hd; ++f) {
+            // Bottom-up RGBA to top-down RGB
+            const uint8_t* src = mapped[f % kSlots];
+            if (src) {
+                for (int y = 0; y < h; ++y) {
+                    const uint8_t* row = src + (size_t)(h - 1 - y) * w * 4;
+                    uint8_t* out = rgb.data() + (size_t)y * w * 3;
+                    for (int x = 0; x < w; ++x) {
+                        out[3 * x + 0] = row[4 * x + 0];
+                        out[3 * x + 1] = row[4 * x + 1];
+                        out[3 * x + 2] = row[4 * x + 2];
+                    }
+                }
+            }
+            tail.store(f + 1, std::memory_order_release); // the render thread may unmap it now
+            if (!src) continue; // mapping failed
+
+            if (pipe) {
+                if (std::fwrite(rgb.data(), 1, rgb.size(), pipe) != rgb.size())
+                    std::cerr << "Frame capture: write to ffmpeg failed" << std::endl;
+            } else {
+                char name[32];
+                std::snprintf(name, sizeof(name), "frame_%06llu.png", (unsigned long long)encodedCount);
+                writePng((std::filesystem::path(directory) / name).string().c_str(), w, h, rgb.data());
+            }
+            ++encodedCount;
+        }
+        if (stop) return;
+    }
+}
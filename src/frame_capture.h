@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records what is on screen without stalling the render loop.
+//
+// capture() starts an asynchronous glReadPixels of the back buffer into the
+// next of a ring of pixel buffer objects and fences it. On later frames,
+// reads whose fence has signalled are mapped and the mapped pixels are handed
+// straight to a background encoder thread, which flips them to top-first RGB
+// and writes a PNG (png_writer.h) or pipes them as raw video to an ffmpeg
+// process. Once the encoder is done with a frame, the render thread unmaps
+// the buffer and it goes back into the ring.
+//
+// The render thread never waits for either the GPU or the encoder. If all
+// PBOs are still busy, the frame is dropped and counted instead.
+class FrameCapture {
+public:
+    FrameCapture() = default;
+    ~FrameCapture() { close(); }
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // target: a directory for frame_000000.png, ... or "ffmpeg:OUT" to encode the video file OUT
+    // (fps is its frame rate). Frames are width x height; needs the GL context current.
+    bool open(const std::string& target, int width, int height, int fps = 60);
+
+    // After the frame's draws, before swapping buffers. Frames whose framebuffer is not
+    // width x height (the window was resized) are skipped.
+    void capture(int fbWidth, int fbHeight);
+
+    // Finish the reads in flight, encode everything handed over, stop the encoder
+    void close();
+
+    bool isOpen() const { return worker.joinable(); }
+    uint64_t captured() const { return encodedCount; }
+    uint64_t dropped() const { return droppedCount; }
+
+    static constexpr int kSlots = 4; // PBOs: reading on the GPU, mapped for the encoder, or free
+
+private:
+    void handOver(bool wait); // map landed reads and pass them to the encoder
+    void release();           // unmap what the encoder has finished
+    void run();
+
+    int w = 0, h = 0;
+    GLuint pbos[kSlots] = {};
+    GLsync fences[kSlots] = {};
+    const uint8_t* mapped[kSlots] = {}; // RGBA, bottom row first
+    uint64_t issued = 0;                // reads started (render thread)
+    uint64_t released = 0;              // buffers unmapped (render thread)
+    std::atomic<uint64_t> head{0};      // frames mapped and handed over (render thread)
+    std::atomic<uint64_t> tail{0};      // frames encoded (encoder thread)
+    uint64_t droppedCount = 0;
+    uint64_t encodedCount = 0;
+
+    std::string directory;  // PNG output, or
+    FILE* pipe = nullptr;   // ffmpeg's stdin
+    std::vector<uint8_t> rgb;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+};
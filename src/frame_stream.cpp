@@ -0,0 +1,478 @@
+#include "frame_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS: SO_NOSIGPIPE is set on the socket instead
+#endif
+
+// ---- encoding, shared by both ends ----
+
+static uint16_t zigzag(int16_t r) { return (uint16_t)(((uint16_t)r << 1) ^ (uint16_t)(r >> 15)); }
+static int16_t unzigzag(uint16_t z) { return (int16_t)((z >> 1) ^ (uint16_t)(-(int)(z & 1))); }
+
+// Prediction for value i from the frames both ends hold (wraps mod 2^16 on both)
+static uint16_t predict(const std::vector<uint16_t>& ref0, const std::vector<uint16_t>& ref1, size_t i, bool linear) {
+    return linear ? (uint16_t)(2 * (int)ref1[i] - (int)ref0[i]) : ref1[i];
+}
+
+// After a frame is sent / decoded: it becomes the newest reference
+static void advanceRefs(std::vector<uint16_t>& ref0, std::vector<uint16_t>& ref1, std::vector<uint16_t>& quant,
+                        bool key) {
+    if (key) ref0 = quant;   // no history yet: the next frame predicts "no motion"
+    else std::swap(ref0, ref1);
+    std::swap(ref1, quant);
+}
+
+#ifdef _WIN32
+
+bool FrameStreamServer::listen(const std::string&) {
+    std::cerr << "Frame streaming is not supported on this platform" << std::endl;
+    return false;
+}
+bool FrameStreamServer::submit(const Particle*, size_t, double, uint64_t) { return false; }
+void FrameStreamServer::close() {}
+void FrameStreamServer::run() {}
+void FrameStreamServer::acceptViewer() {}
+void FrameStreamServer::dropViewer() {}
+void FrameStreamServer::encode(const Frame&) {}
+
+bool FrameStreamClient::connect(const std::string&, double) {
+    std::cerr << "Frame streaming is not supported on this platform" << std::endl;
+    return false;
+}
+void FrameStreamClient::close() {}
+bool FrameStreamClient::poll(std::vector<Particle>&, double*) { return false; }
+bool FrameStreamClient::waitFirst(double) { return false; }
+void FrameStreamClient::run() {}
+bool FrameStreamClient::decode(const StreamFrameHeader&, const std::vector<unsigned char>&) { return false; }
+
+#else
+
+// ---- sockets ----
+
+// Open a listening (server) or connected (client) socket for an address; -1 on failure
+static int openSocket(const std::string& address, bool server, bool quiet) {
+    if (address.compare(0, 4, "tcp:") == 0) {
+        std::string rest = address.substr(4), host = "127.0.0.1", port = rest;
+        size_t colon = rest.rfind(':');
+        if (colon != std::string::npos) {
+            host = rest.substr(0, colon);
+            port = rest.substr(colon + 1);
+        }
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = server ? AI_PASSIVE : 0;
+        addrinfo* list = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &list) != 0) {
+            std::cerr << "Cannot resolve stream address " << address << std::endl;
+            return -1;
+        }
+        int fd = -1;
+        for (addrinfo* a = list; a && fd < 0; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            bool ok;
+            if (server) {
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                ok = bind(fd, a->ai_addr, a->ai_addrlen) == 0 && ::listen(fd, 1) == 0;
+            } else {
+                ok = ::connect(fd, a->ai_addr, a->ai_addrlen) == 0;
+                if (ok) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+            if (!ok) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(list);
+        if (fd < 0 && !quiet) std::cerr << "Cannot " << (server ? "listen on " : "connect to ") << address << std::endl;
+        return fd;
+    }
+
+    sockaddr_un sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if (address.empty() || address.size() >= sizeof(sa.sun_path)) {
+        std::cerr << "Bad Unix socket path '" << address << "'" << std::endl;
+        return -1;
+    }
+    std::memcpy(sa.sun_path, address.c_str(), address.size());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    bool ok;
+    if (server) {
+        ::unlink(address.c_str()); // stale socket from an earlier run
+        ok = bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0 && ::listen(fd, 1) == 0;
+    } else {
+        ok = ::connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0;
+    }
+    if (!ok) {
+        if (!quiet) std::cerr << "Cannot " << (server ? "listen on " : "connect to ") << address << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Write all of buf; a send timeout only retries (so a stalled viewer cannot
+// wedge close()), any other error gives up
+static bool sendAll(int fd, const unsigned char* buf, size_t n, const std::atomic<bool>& stopping) {
+    while (n > 0) {
+        ssize_t r = ::send(fd, buf, n, MSG_NOSIGNAL);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && !stopping) continue;
+            return false;
+        }
+        buf += r;
+        n -= (size_t)r;
+    }
+    return true;
+}
+
+static bool recvAll(int fd, void* dst, size_t n) {
+    unsigned char* p = static_cast<unsigned char*>(dst);
+    while (n > 0) {
+        ssize_t r = ::recv(fd, p, n, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= (size_t)r;
+    }
+    return true;
+}
+
+// ---- server ----
+
+bool FrameStreamServer::listen(const std::string& address) {
+    close();
+    listenFd = openSocket(address, true, false);
+    if (listenFd < 0) return false;
+    if (address.compare(0, 4, "tcp:") != 0) unixPath = address;
+    stopping = false;
+    worker = std::thread([this] { run(); });
+    return true;
+}
+
+bool FrameStreamServer::submit(const Particle* pts, size_t count, double time, uint64_t step) {
+    if (!connected.load(std::memory_order_acquire)) return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (hasPending) {
+            ++droppedCount; // sender still busy with the previous two frames
+            return false;
+        }
+    }
+    // Only this thread fills `pending` while hasPending is false
+    pending.pos.resize(count);
+    for (size_t i = 0; i < count; ++i) pending.pos[i] = pts[i].pos;
+    pending.color.clear();
+    if (needColors.load(std::memory_order_acquire)) {
+        pending.color.resize(count);
+        for (size_t i = 0; i < count; ++i) pending.color[i] = pts[i].color;
+    }
+    pending.time = time;
+    pending.step = step;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        hasPending = true;
+    }
+    wake.notify_one();
+    return true;
+}
+
+void FrameStreamServer::close() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+    dropViewer();
+    ::close(listenFd);
+    listenFd = -1;
+    if (!unixPath.empty()) ::unlink(unixPath.c_str());
+    unixPath.clear();
+    if (sentFrames > 0)
+        std::cout << "Streamed " << sentFrames << " frames (" << droppedCount.load() << " dropped), "
+                  << sentBytes / (1024 * 1024) << " MiB, " << (double)rawBytes / (double)std::max<uint64_t>(1, sentBytes)
+                  << "x smaller than raw floats" << std::endl;
+}
+
+void FrameStreamServer::acceptViewer() {
+    pollfd p = {listenFd, POLLIN, 0};
+    if (::poll(&p, 1, 0) <= 0) return;
+    int fd = ::accept(listenFd, nullptr, nullptr);
+    if (fd < 0) return;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // harmless failure on Unix sockets
+#ifdef SO_NOSIGPIPE
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    timeval tv = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    viewerFd = fd;
+    sinceKey = 0;
+    needColors = true;
+    connected.store(true, std::memory_order_release);
+    std::cout << "Stream viewer connected" << std::endl;
+}
+
+void FrameStreamServer::dropViewer() {
+    if (viewerFd < 0) return;
+    connected.store(false, std::memory_order_release);
+    ::close(viewerFd);
+    viewerFd = -1;
+    sinceKey = 0;
+    std::cout << "Stream viewer disconnected" << std::endl;
+}
+
+void FrameStreamServer::run() {
+    for (;;) {
+        bool have = false;
+        {
+            // Poll for a viewer every 100 ms while none is connected
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(100), [this] { return stopping || hasPending; });
+            if (stopping) return;
+            if (hasPending) {
+                std::swap(pending, sending);
+                hasPending = false; // the simulation may fill the other buffer now
+                have = true;
+            }
+        }
+        if (viewerFd < 0) acceptViewer();
+        else if (have) encode(sending);
+    }
+}
+
+void FrameStreamServer::encode(const Frame& f) {
+    const size_t n = f.pos.size();
+    const bool withColors = needColors.load(std::memory_order_acquire);
+    if (withColors && f.color.size() != n) return; // queued before the viewer arrived
+    const float* p = reinterpret_cast<const float*>(f.pos.data());
+
+    bool key = withColors || sinceKey == 0 || sinceKey >= kStreamKeyInterval || ref1.size() != 3 * n;
+    quant.resize(3 * n);
+    if (!key) {
+        // Same box as the references; leaving it forces a keyframe
+        for (size_t i = 0; i < 3 * n && !key; ++i) {
+            const int a = (int)(i % 3);
+            const float q = std::round((p[i] - boxMin[a]) / boxScale[a]);
+            if (!(q >= 0.0f && q <= 65535.0f)) key = true;
+            else quant[i] = (uint16_t)q;
+        }
+    }
+    if (key) {
+        float lo[3] = {INFINITY, INFINITY, INFINITY}, hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+        for (size_t i = 0; i < 3 * n; ++i) {
+            lo[i % 3] = std::min(lo[i % 3], p[i]);
+            hi[i % 3] = std::max(hi[i % 3], p[i]);
+        }
+        for (int a = 0; a < 3; ++a) {
+            if (n == 0) lo[a] = hi[a] = 0.0f;
+            const float pad = 0.25f * (hi[a] - lo[a]) + 1e-3f; // room to move before the next keyframe
+            boxMin[a] = lo[a] - pad;
+            boxScale[a] = (hi[a] - lo[a] + 2.0f * pad) / 65535.0f;
+        }
+        for (size_t i = 0; i < 3 * n; ++i) {
+            const int a = (int)(i % 3);
+            quant[i] = (uint16_t)std::clamp(std::round((p[i] - boxMin[a]) / boxScale[a]), 0.0f, 65535.0f);
+        }
+    }
+
+    StreamFrameHeader h;
+    std::memcpy(h.magic, kStreamMagic, sizeof(h.magic));
+    h.frame = frameNumber;
+    h.time = f.time;
+    h.step = f.step;
+    h.count = (uint32_t)n;
+    h.flags = (key ? kStreamKey : 0u) | (withColors ? kStreamColors : 0u) | (!key && sinceKey >= 2 ? kStreamLinear : 0u);
+    std::memcpy(h.boxMin, boxMin, sizeof(boxMin));
+    std::memcpy(h.boxScale, boxScale, sizeof(boxScale));
+
+    message.resize(sizeof(h));
+    if (withColors) {
+        for (size_t i = 0; i < n; ++i)
+            for (int a = 0; a < 3; ++a)
+                message.push_back((unsigned char)std::clamp((int)std::lround(f.color[i][a] * 255.0f), 0, 255));
+    }
+    if (key) {
+        for (uint16_t q : quant) {
+            message.push_back((unsigned char)(q & 0xff));
+            message.push_back((unsigned char)(q >> 8));
+        }
+    } else {
+        const bool linear = (h.flags & kStreamLinear) != 0;
+        for (size_t i = 0; i < 3 * n; ++i) {
+            uint16_t z = zigzag((int16_t)(uint16_t)(quant[i] - predict(ref0, ref1, i, linear)));
+            while (z >= 0x80) {
+                message.push_back((unsigned char)(z | 0x80));
+                z >>= 7;
+            }
+            message.push_back((unsigned char)z);
+        }
+    }
+    h.payloadBytes = (uint32_t)(message.size() - sizeof(h));
+    std::memcpy(message.data(), &h, sizeof(h));
+
+    if (!sendAll(viewerFd, message.data(), message.size(), stopping)) {
+        dropViewer();
+        return;
+    }
+    if (withColors) needColors = false;
+    advanceRefs(ref0, ref1, quant, key);
+    sinceKey = key ? 1 : sinceKey + 1;
+    ++frameNumber;
+    ++sentFrames;
+    sentBytes += message.size();
+    rawBytes += sizeof(h) + n * 3 * sizeof(float);
+}
+
+// ---- client ----
+
+bool FrameStreamClient::connect(const std::string& address, double timeoutSeconds) {
+    close();
+    // The simulation may still be starting: retry until the timeout
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeoutSeconds);
+    for (;;) {
+        fd = openSocket(address, false, true);
+        if (fd >= 0) break;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            std::cerr << "Cannot connect to stream " << address << std::endl;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    disconnected = false;
+    any = fresh = freshColor = false;
+    worker = std::thread([this] { run(); });
+    return true;
+}
+
+void FrameStreamClient::close() {
+    if (fd < 0) return;
+    ::shutdown(fd, SHUT_RDWR); // wakes the reader
+    if (worker.joinable()) worker.join();
+    ::close(fd);
+    fd = -1;
+}
+
+bool FrameStreamClient::poll(std::vector<Particle>& pts, double* time) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!fresh) return false;
+    if (pts.size() != newest.size()) {
+        pts.resize(newest.size());
+        for (Particle& p : pts) {
+            p.color = glm::vec3(1.0f); // until the colors arrive
+            p.vel = glm::vec3(0.0f);
+            p.mass = 1.0f;
+        }
+    }
+    for (size_t i = 0; i < newest.size(); ++i) pts[i].pos = newest[i];
+    if (freshColor && newestColor.size() == pts.size()) {
+        for (size_t i = 0; i < pts.size(); ++i) pts[i].color = newestColor[i];
+        freshColor = false;
+    }
+    if (time) *time = newestTime;
+    fresh = false;
+    return true;
+}
+
+bool FrameStreamClient::waitFirst(double timeoutSeconds) {
+    std::unique_lock<std::mutex> lock(mutex);
+    ready.wait_for(lock, std::chrono::duration<double>(timeoutSeconds), [this] { return any || disconnected; });
+    return any;
+}
+
+void FrameStreamClient::run() {
+    std::vector<unsigned char> payload;
+    for (;;) {
+        StreamFrameHeader h;
+        if (!recvAll(fd, &h, sizeof(h))) break;
+        if (std::memcmp(h.magic, kStreamMagic, sizeof(h.magic)) != 0) {
+            std::cerr << "Bad frame on stream" << std::endl;
+            break;
+        }
+        payload.resize(h.payloadBytes);
+        if (!recvAll(fd, payload.data(), payload.size()) || !decode(h, payload)) break;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::swap(newest, decoded);
+        newestTime = h.time;
+        if (h.flags & kStreamColors) {
+            std::swap(newestColor, decodedColor);
+            freshColor = true;
+        }
+        fresh = true;
+        any = true;
+        ready.notify_all();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    disconnected = true;
+    ready.notify_all();
+}
+
+bool FrameStreamClient::decode(const StreamFrameHeader& h, const std::vector<unsigned char>& payload) {
+    const size_t n = h.count;
+    const unsigned char* in = payload.data();
+    const unsigned char* end = in + payload.size();
+    if (h.flags & kStreamColors) {
+        if ((size_t)(end - in) < 3 * n) return false;
+        decodedColor.resize(n);
+        for (size_t i = 0; i < n; ++i, in += 3)
+            decodedColor[i] = glm::vec3(in[0], in[1], in[2]) / 255.0f;
+    }
+
+    const bool key = (h.flags & kStreamKey) != 0;
+    quant.resize(3 * n);
+    if (key) {
+        if ((size_t)(end - in) < 6 * n) return false;
+        for (size_t i = 0; i < 3 * n; ++i, in += 2) quant[i] = (uint16_t)(in[0] | (in[1] << 8));
+    } else {
+        if (ref1.size() != 3 * n) {
+            std::cerr << "Stream delta frame without a keyframe" << std::endl;
+            return false;
+        }
+        const bool linear = (h.flags & kStreamLinear) != 0;
+        for (size_t i = 0; i < 3 * n; ++i) {
+            uint32_t z = 0;
+            for (int shift = 0;; shift += 7) {
+                if (in == end || shift > 14) return false;
+                const unsigned char b = *in++;
+                z |= (uint32_t)(b & 0x7f) << shift;
+                if (!(b & 0x80)) break;
+            }
+            quant[i] = (uint16_t)(predict(ref0, ref1, i, linear) + unzigzag((uint16_t)z));
+        }
+    }
+
+    decoded.resize(n);
+    for (size_t i = 0; i < n; ++i)
+        for (int a = 0; a < 3; ++a)
+            decoded[i][a] = h.boxMin[a] + (float)quant[3 * i + a] * h.boxScale[a];
+    advanceRefs(ref0, ref1, quant, key);
+    return true;
+}
+
+#endif
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "particle.h"
+
+// Streaming particle positions to a viewer over a socket.
+//
+// Addresses are a Unix domain socket path ("/tmp/nbody.sock") or
+// "tcp:[HOST:]PORT" (the server binds HOST, default 127.0.0.1).
+//
+// Every frame is one message: a StreamFrameHeader followed by its payload.
+// Positions are quantized to 16 bits per axis inside a bounding box that is
+// fixed between keyframes, so the error is at most half a quantum,
+// (box extent) / 131070 per axis. A keyframe carries the quantized values
+// as-is; every other frame carries, per value, the difference from a
+// prediction made from the frames the viewer already has (the previous
+// position, or a linear extrapolation of the previous two), zigzag mapped
+// and written as a 1-3 byte varint. Smooth motion leaves residuals of a few
+// quanta, about 3 bytes per particle against 12 for raw floats. Colors
+// (RGB8) are sent once, with the first keyframe a new viewer receives.
+//
+// A new keyframe (with a new box) is sent every kStreamKeyInterval frames,
+// when a particle leaves the box, or when the count changes. Only the frames
+// actually sent are ever used as references, so dropped frames cost nothing
+// but smoothness.
+
+static constexpr char kStreamMagic[4] = {'N', 'B', 'S', 'F'};
+static constexpr uint32_t kStreamKeyInterval = 120;
+
+enum StreamFrameFlags : uint32_t {
+    kStreamKey = 1,       // quantized values, 2 bytes each
+    kStreamColors = 2,    // count x RGB8 precede the positions
+    kStreamLinear = 4,    // residuals against 2 * previous - the one before (else against previous)
+};
+
+struct StreamFrameHeader {
+    char     magic[4];
+    uint32_t payloadBytes;
+    uint64_t frame;
+    double   time;
+    uint64_t step;
+    uint32_t count;
+    uint32_t flags;
+    float    boxMin[3];
+    float    boxScale[3];     // world units per quantum
+};
+static_assert(sizeof(StreamFrameHeader) == 64, "stream header layout");
+
+// Simulation side. One viewer at a time; later ones wait until it disconnects.
+//
+// submit() copies the positions into a spare buffer and returns; a sender
+// thread encodes and writes them. If the sender still has a frame waiting
+// (the viewer or the network is slower than the simulation) the new frame is
+// dropped instead, so physics never waits on the socket.
+class FrameStreamServer {
+public:
+    FrameStreamServer() = default;
+    ~FrameStreamServer() { close(); }
+    FrameStreamServer(const FrameStreamServer&) = delete;
+    FrameStreamServer& operator=(const FrameStreamServer&) = delete;
+
+    bool listen(const std::string& address); // prints the reason and returns false on failure
+    // Queue a frame; false if it was dropped (no viewer, or the previous frame is still waiting)
+    bool submit(const Particle* pts, size_t count, double time, uint64_t step);
+    void close(); // disconnects the viewer and prints what was sent
+
+    bool isOpen() const { return worker.joinable(); }
+
+private:
+    struct Frame {
+        std::vector<glm::vec3> pos;
+        std::vector<glm::vec3> color; // only while a new viewer still needs colors
+        double time = 0.0;
+        uint64_t step = 0;
+    };
+
+    void run();
+    void acceptViewer();
+    void dropViewer();
+    void encode(const Frame& f);
+
+    int listenFd = -1;
+    int viewerFd = -1;
+    std::string unixPath;            // removed on close
+
+    Frame pending, sending;
+    bool hasPending = false;
+    std::atomic<bool> stopping{false};
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+    std::atomic<bool> connected{false};
+    std::atomic<bool> needColors{false};
+
+    // Encoder state (sender thread only)
+    std::vector<uint16_t> ref0, ref1; // the two frames the viewer decoded last (ref1 newest)
+    std::vector<uint16_t> quant;
+    std::vector<unsigned char> message;
+    uint32_t sinceKey = 0;            // frames sent since the last keyframe (0 = next is a keyframe)
+    uint64_t frameNumber = 0;
+    float boxMin[3] = {0, 0, 0};
+    float boxScale[3] = {1, 1, 1};
+
+    std::atomic<uint64_t> droppedCount{0};
+    uint64_t sentFrames = 0;
+    uint64_t sentBytes = 0;
+    uint64_t rawBytes = 0;
+};
+
+// Viewer side: connects, decodes every message on a background thread and
+// keeps the newest frame for the render loop
+class FrameStreamClient {
+public:
+    FrameStreamClient() = default;
+    ~FrameStreamClient() { close(); }
+    FrameStreamClient(const FrameStreamClient&) = delete;
+    FrameStreamClient& operator=(const FrameStreamClient&) = delete;
+
+    bool connect(const std::string& address, double timeoutSeconds = 10.0);
+    void close();
+
+    // Copy the newest decoded frame into pts if there is one since the last call
+    // (resizing pts, and setting colors when they arrived); false if nothing new
+    bool poll(std::vector<Particle>& pts, double* time = nullptr);
+    // Block until the first frame has been decoded; false on disconnect or timeout
+    bool waitFirst(double timeoutSeconds);
+    bool ended() const { return disconnected; }
+
+private:
+    void run();
+    bool decode(const StreamFrameHeader& h, const std::vector<unsigned char>& payload);
+
+    int fd = -1;
+    std::thread worker;
+    std::atomic<bool> disconnected{false};
+
+    std::vector<uint16_t> ref0, ref1, quant; // reader thread only
+    std::vector<glm::vec3> decoded, decodedColor;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::vector<glm::vec3> newest, newestColor;
+    double newestTime = 0.0;
+    bool fresh = false;
+    bool freshColor = false;
+    bool any = false;
+};
@@ -0,0 +1,357 @@
+#include "gadget.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "file_io.h"
+
+static constexpr size_t kGadgetChunk = 1u << 20; // staging bytes per streamed read / write
+
+// Display colors by GADGET particle type: gas, halo, disk, bulge, stars, boundary
+static const glm::vec3 kTypeColors[6] = {
+    glm::vec3(1.0f, 0.55f, 0.3f), glm::vec3(0.45f, 0.55f, 1.0f), glm::vec3(0.8f, 0.85f, 1.0f),
+    glm::vec3(1.0f, 0.85f, 0.55f), glm::vec3(1.0f, 1.0f, 0.8f), glm::vec3(0.6f, 0.6f, 0.6f),
+};
+
+static uint32_t byteSwap(uint32_t v) {
+    return (v >> 24) | ((v >> 8) & 0xff00u) | ((v << 8) & 0xff0000u) | (v << 24);
+}
+
+// Cursor over the Fortran records of one file
+struct GadgetReader {
+    BlockFile file;
+    std::string path;
+    uint64_t size = 0;
+    uint64_t next = 0; // offset of the next record
+    int format = 0;
+
+    bool open(const std::string& p) {
+        path = p;
+        std::error_code ec;
+        size = std::filesystem::file_size(p, ec);
+        if (ec || !file.openRead(p.c_str(), false)) {
+            std::cerr << "Failed to open file: " << p << std::endl;
+            return false;
+        }
+        uint32_t first = 0;
+        if (size < 4 || !file.readAt(&first, 4, 0)) first = 0;
+        if (first == 256) format = 1;
+        else if (first == 8) format = 2;
+        else if (byteSwap(first) == 256 || byteSwap(first) == 8)
+            std::cerr << "Big-endian GADGET files are not supported: " << p << std::endl;
+        else
+            std::cerr << "Not a GADGET file: " << p << std::endl;
+        return format != 0;
+    }
+
+    // Advance to the next block. Format 1 blocks have an empty label.
+    bool nextBlock(char label[5], uint64_t& offset, uint64_t& bytes) {
+        std::memset(label, 0, 5);
+        if (next + 8 > size) return false;
+        if (format == 2) {
+            uint32_t tag[4]; // 8, label, next size, 8
+            if (!file.readAt(tag, sizeof(tag), next) || tag[0] != 8 || tag[3] != 8) return corrupt();
+            std::memcpy(label, &tag[1], 4);
+            next += sizeof(tag);
+        }
+        uint32_t head = 0, tail = 0;
+        if (!file.readAt(&head, 4, next) || next + 8 + head > size) return corrupt();
+        if (!file.readAt(&tail, 4, next + 4 + head) || tail != head) return corrupt();
+        offset = next + 4;
+        bytes = head;
+        next += 8 + (uint64_t)head;
+        return true;
+    }
+
+    bool corrupt() {
+        std::cerr << "Corrupt GADGET record at offset " << next << ": " << path << std::endl;
+        next = size;
+        return false;
+    }
+
+    // Stream `count` elements of `comps` values (float or double, judged from
+    // the block size) through fn(element, const double* values)
+    template <typename Fn>
+    bool stream(uint64_t offset, uint64_t bytes, size_t count, int comps, Fn&& fn) {
+        if (count == 0) return true;
+        const uint64_t width = bytes / ((uint64_t)count * comps);
+        if ((width != 4 && width != 8) || width * count * comps != bytes) {
+            std::cerr << "GADGET block has " << bytes << " bytes for " << count << " particles: " << path << std::endl;
+            return false;
+        }
+        const size_t elem = (size_t)width * comps;
+        const size_t per = kGadgetChunk / elem;
+        std::vector<unsigned char> buf(per * elem);
+        double v[3];
+        for (size_t c0 = 0; c0 < count; c0 += per) {
+            const size_t nc = std::min(per, count - c0);
+            if (!file.readAt(buf.data(), nc * elem, offset + (uint64_t)c0 * elem)) {
+                std::cerr << "GADGET read failed: " << path << std::endl;
+                return false;
+            }
+            for (size_t i = 0; i < nc; ++i) {
+                const unsigned char* src = buf.data() + i * elem;
+                for (int k = 0; k < comps; ++k) {
+                    if (width == 4) {
+                        float f;
+                        std::memcpy(&f, src + 4 * k, 4);
+                        v[k] = f;
+                    } else {
+                        std::memcpy(&v[k], src + 8 * k, 8);
+                    }
+                }
+                fn(c0 + i, v);
+            }
+        }
+        return true;
+    }
+};
+
+static bool readHeader(GadgetReader& r, GadgetHeader& h) {
+    char label[5];
+    uint64_t offset = 0, bytes = 0;
+    if (!r.nextBlock(label, offset, bytes)) return false;
+    if ((r.format == 2 && std::strncmp(label, "HEAD", 4) != 0) || bytes != sizeof(GadgetHeader) ||
+        !r.file.readAt(&h, sizeof(h), offset)) {
+        std::cerr << "Missing GADGET header: " << r.path << std::endl;
+        return false;
+    }
+    for (int t = 0; t < 6; ++t) {
+        if (h.npart[t] < 0) {
+            std::cerr << "Corrupt GADGET header: " << r.path << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t headerCount(const GadgetHeader& h) {
+    size_t n = 0;
+    for (int t = 0; t < 6; ++t) n += (size_t)h.npart[t];
+    return n;
+}
+
+// Read one file into out[0, count); particles are in type order
+static bool readGadgetFile(const std::string& path, Particle* out, size_t count) {
+    GadgetReader r;
+    GadgetHeader h;
+    if (!r.open(path) || !readHeader(r, h)) return false;
+    if (headerCount(h) != count) {
+        std::cerr << "GADGET header changed while reading: " << path << std::endl;
+        return false;
+    }
+
+    // Types in file order; table masses now, per-particle ones from MASS
+    size_t start[7] = {0};
+    size_t massCount = 0;
+    for (int t = 0; t < 6; ++t) {
+        start[t + 1] = start[t] + (size_t)h.npart[t];
+        for (size_t i = start[t]; i < start[t + 1]; ++i) {
+            out[i].color = kTypeColors[t];
+            out[i].mass = (float)h.massTable[t];
+        }
+        if (h.massTable[t] == 0.0) massCount += (size_t)h.npart[t];
+    }
+
+    bool havePos = false, haveVel = false;
+    char label[5];
+    uint64_t offset = 0, bytes = 0;
+    for (int block = 1; r.nextBlock(label, offset, bytes); ++block) {
+        // Format 1 has no labels: POS, VEL, ID, MASS by position
+        if (r.format == 1) {
+            static const char* order[] = {"", "POS ", "VEL ", "ID  ", "MASS"};
+            if (block > 4) break;
+            std::memcpy(label, order[block], 4);
+        }
+        bool ok = true;
+        if (std::strncmp(label, "POS ", 4) == 0) {
+            ok = havePos = r.stream(offset, bytes, count, 3, [&](size_t i, const double* v) {
+                out[i].pos = glm::vec3((float)v[0], (float)v[1], (float)v[2]);
+            });
+        } else if (std::strncmp(label, "VEL ", 4) == 0) {
+            ok = haveVel = r.stream(offset, bytes, count, 3, [&](size_t i, const double* v) {
+                out[i].vel = glm::vec3((float)v[0], (float)v[1], (float)v[2]);
+            });
+        } else if (std::strncmp(label, "MASS", 4) == 0 && massCount > 0) {
+            // The k-th stored mass belongs to the k-th particle of a type without a table mass
+            int t = 0;
+            size_t j = 0;
+            ok = r.stream(offset, bytes, massCount, 1, [&](size_t, const double* v) {
+                while (h.massTable[t] != 0.0 || j >= (size_t)h.npart[t]) {
+                    ++t;
+                    j = 0;
+                }
+                out[start[t] + j++].mass = (float)v[0];
+            });
+        }
+        if (!ok) return false;
+    }
+    if (!havePos || !haveVel) {
+        std::cerr << "GADGET file lacks POS/VEL blocks: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// The files making up the snapshot `path` refers to
+static bool gadgetFiles(const std::string& path, std::vector<std::string>& files, GadgetHeader& first) {
+    namespace fs = std::filesystem;
+    std::string probe = fs::exists(path) ? path : path + ".0";
+    GadgetReader r;
+    if (!r.open(probe) || !readHeader(r, first)) return false;
+    if (first.numFiles <= 1) {
+        files.assign(1, probe);
+        return true;
+    }
+
+    // Strip a trailing ".<digits>" to get the base name of the set
+    std::string base = probe;
+    size_t dot = base.find_last_of('.');
+    if (dot != std::string::npos && dot + 1 < base.size() &&
+        base.find_first_not_of("0123456789", dot + 1) == std::string::npos)
+        base.erase(dot);
+    files.clear();
+    for (int i = 0; i < first.numFiles; ++i) {
+        files.push_back(base + "." + std::to_string(i));
+        if (!fs::exists(files.back())) {
+            std::cerr << "Missing file " << i << " of " << first.numFiles << ": " << files.back() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readGadget(const char* path, std::vector<Particle>& pts, GadgetHeader* header) {
+    std::vector<std::string> files;
+    GadgetHeader first;
+    if (!gadgetFiles(path, files, first)) return false;
+    if (header) *header = first;
+
+    // Headers first, to place every file's particles in the output
+    std::vector<size_t> offsets(files.size() + 1, 0);
+    for (size_t f = 0; f < files.size(); ++f) {
+        GadgetReader r;
+        GadgetHeader h;
+        if (!r.open(files[f]) || !readHeader(r, h)) return false;
+        offsets[f + 1] = offsets[f] + headerCount(h);
+    }
+    pts.assign(offsets.back(), Particle{glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(0.0f), 1.0f});
+
+    // One thread per file, each streaming into its own slice
+    std::vector<char> ok(files.size(), 0);
+    std::vector<std::thread> readers;
+    for (size_t f = 1; f < files.size(); ++f)
+        readers.emplace_back([&, f] { ok[f] = readGadgetFile(files[f], pts.data() + offsets[f], offsets[f + 1] - offsets[f]); });
+    ok[0] = readGadgetFile(files[0], pts.data(), offsets[1]);
+    for (auto& t : readers) t.join();
+    return std::all_of(ok.begin(), ok.end(), [](char c) { return c != 0; });
+}
+
+// Buffered, sequential Fortran-record output
+struct GadgetRecordWriter {
+    BlockFile& file;
+    int format;
+    uint64_t offset = 0;
+    std::vector<unsigned char> buf;
+    size_t used = 0;
+    uint32_t recordBytes = 0;
+    bool ok = true;
+
+    GadgetRecordWriter(BlockFile& f, int fmt) : file(f), format(fmt), buf(kGadgetChunk) {}
+
+    void begin(const char* label, uint32_t bytes) {
+        if (format == 2) {
+            uint32_t tag[4] = {8, 0, bytes + 8, 8};
+            std::memcpy(&tag[1], label, 4);
+            put(tag, sizeof(tag));
+        }
+        recordBytes = bytes;
+        put(&recordBytes, 4);
+    }
+    void end() { put(&recordBytes, 4); }
+
+    void put(const void* src, size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(src);
+        while (ok && bytes > 0) {
+            size_t n = std::min(bytes, buf.size() - used);
+            std::memcpy(buf.data() + used, p, n);
+            used += n;
+            p += n;
+            bytes -= n;
+            if (used == buf.size()) flush();
+        }
+    }
+    void flush() {
+        if (ok && used > 0) ok = file.writeAt(buf.data(), used, offset);
+        offset += used;
+        used = 0;
+    }
+};
+
+bool writeGadget(const char* path, const std::vector<Particle>& pts, double time, int format) {
+    const size_t n = pts.size();
+    if (n * 3 * sizeof(float) > (size_t)INT32_MAX) {
+        std::cerr << "Too many particles for a single GADGET file: " << n << std::endl;
+        return false;
+    }
+    const bool uniformMass = std::all_of(pts.begin(), pts.end(), [&](const Particle& p) { return p.mass == pts[0].mass; });
+
+    GadgetHeader h;
+    std::memset(&h, 0, sizeof(h));
+    h.npart[1] = (int32_t)n;
+    h.npartTotal[1] = (uint32_t)n;
+    h.massTable[1] = (uniformMass && n > 0) ? pts[0].mass : 0.0;
+    h.time = time;
+    h.numFiles = 1;
+
+    const std::string tmp = std::string(path) + ".tmp";
+    BlockFile file;
+    if (!file.openWrite(tmp.c_str(), false)) return false;
+    GadgetRecordWriter w(file, format == 1 ? 1 : 2);
+
+    w.begin("HEAD", sizeof(h));
+    w.put(&h, sizeof(h));
+    w.end();
+
+    float v[3];
+    w.begin("POS ", (uint32_t)(n * sizeof(v)));
+    for (const Particle& p : pts) {
+        v[0] = p.pos.x; v[1] = p.pos.y; v[2] = p.pos.z;
+        w.put(v, sizeof(v));
+    }
+    w.end();
+    w.begin("VEL ", (uint32_t)(n * sizeof(v)));
+    for (const Particle& p : pts) {
+        v[0] = p.vel.x; v[1] = p.vel.y; v[2] = p.vel.z;
+        w.put(v, sizeof(v));
+    }
+    w.end();
+    w.begin("ID  ", (uint32_t)(n * sizeof(uint32_t)));
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t id = (uint32_t)(i + 1);
+        w.put(&id, sizeof(id));
+    }
+    w.end();
+    if (h.massTable[1] == 0.0 && n > 0) {
+        w.begin("MASS", (uint32_t)(n * sizeof(float)));
+        for (const Particle& p : pts) w.put(&p.mass, sizeof(float));
+        w.end();
+    }
+    w.flush();
+
+    bool ok = w.ok && file.sync();
+    ok = file.close() && ok;
+    std::error_code ec;
+    if (ok) std::filesystem::rename(tmp, path, ec);
+    if (!ok || ec) {
+        std::cerr << "GADGET write failed: " << path << std::endl;
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "particle.h"
+
+// GADGET snapshot files (format 1 and 2, little-endian).
+//
+// Every block is a Fortran record: int32 size, payload, int32 size. Format 2
+// precedes each block with a small record holding a 4-character label
+// ("HEAD", "POS ", ...). Blocks used here: HEAD, POS, VEL, ID and MASS (the
+// latter only for particle types whose mass-table entry is zero). Other
+// blocks are skipped. A snapshot may be split over files "<base>.0" ...
+// "<base>.<numFiles-1>", each with its own header.
+
+struct GadgetHeader {
+    int32_t  npart[6];          // particles of each type in this file
+    double   massTable[6];      // per-type mass; 0 = masses are in the MASS block
+    double   time;
+    double   redshift;
+    int32_t  flagSfr;
+    int32_t  flagFeedback;
+    uint32_t npartTotal[6];     // over all files (low 32 bits)
+    int32_t  flagCooling;
+    int32_t  numFiles;
+    double   boxSize;
+    double   omega0;
+    double   omegaLambda;
+    double   hubbleParam;
+    int32_t  flagStellarAge;
+    int32_t  flagMetals;
+    uint32_t npartTotalHighWord[6];
+    int32_t  flagEntropyInsteadU;
+    char     fill[60];
+};
+static_assert(sizeof(GadgetHeader) == 256, "GADGET header is 256 bytes");
+
+// Read a snapshot into a particle array. `path` is a single file, one file of
+// a set ("snap_010.3" or "snap_010.0"), or the base name of a set
+// ("snap_010"). Each file is read on its own thread; blocks are streamed in
+// chunks straight into pos / vel / mass of their particles, and colors are
+// assigned by particle type. Single- and double-precision blocks are both
+// accepted. `header` receives the first file's header.
+bool readGadget(const char* path, std::vector<Particle>& pts, GadgetHeader* header = nullptr);
+
+// Write all particles as type 1 (halo) into one file, format 1 or 2. Uniform
+// masses go into the mass table, otherwise a MASS block is written. Atomic
+// (temp file + rename), like writeSnapshot.
+bool writeGadget(const char* path, const std::vector<Particle>& pts, double time, int format = 2);
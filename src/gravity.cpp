@@ -0,0 +1,53 @@
+#include "gravity.h"
+
+#include <cmath>
+
+// Targets are processed in small blocks so each block's accumulators stay in
+// registers while we stream once over all sources.
+static constexpr size_t kTargetBlock = 8;
+
+void accumulateGravity(const BodyArrays& src,
+                       const double* tx, const double* ty, const double* tz, size_t nt,
+                       double eps2,
+                       double* ax, double* ay, double* az) {
+    const size_t ns = src.size();
+    const double* sx = src.x.data();
+    const double* sy = src.y.data();
+    const double* sz = src.z.data();
+    const double* sgm = src.gm.data();
+
+    for (size_t t0 = 0; t0 < nt; t0 += kTargetBlock) {
+        const size_t nb = (nt - t0 < kTargetBlock) ? nt - t0 : kTargetBlock;
+
+        // Local copies of the target block (padded lanes are ignored on store)
+        double px[kTargetBlock] = {}, py[kTargetBlock] = {}, pz[kTargetBlock] = {};
+        double accx[kTargetBlock] = {}, accy[kTargetBlock] = {}, accz[kTargetBlock] = {};
+        for (size_t l = 0; l < nb; ++l) {
+            px[l] = tx[t0 + l];
+            py[l] = ty[t0 + l];
+            pz[l] = tz[t0 + l];
+        }
+
+        for (size_t j = 0; j < ns; ++j) {
+            const double qx = sx[j], qy = sy[j], qz = sz[j], m = sgm[j];
+            // Fixed-width lane loop: same work for every lane, selects instead of branches
+            for (size_t l = 0; l < kTargetBlock; ++l) {
+                double dx = qx - px[l];
+                double dy = qy - py[l];
+                double dz = qz - pz[l];
+                double r2 = dx * dx + dy * dy + dz * dz + eps2;
+                double inv = 1.0 / std::sqrt(r2);
+                double w = (r2 > 0.0) ? m * inv * inv * inv : 0.0; // coincident points -> 0
+                accx[l] += w * dx;
+                accy[l] += w * dy;
+                accz[l] += w * dz;
+            }
+        }
+
+        for (size_t l = 0; l < nb; ++l) {
+            ax[t0 + l] += accx[l];
+            ay[t0 + l] += accy[l];
+            az[t0 + l] += accz[l];
+        }
+    }
+}
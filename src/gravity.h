@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Structure-of-arrays view of a set of bodies in double precision.
+// The force kernel works on plain arrays so the inner loop is a straight
+// run of loads/FMAs that the compiler can vectorize (no glm, no branches).
+struct BodyArrays {
+    std::vector<double> x, y, z; // positions
+    std::vector<double> gm;      // G * mass (0 for massless tracers)
+
+    size_t size() const { return x.size(); }
+    void resize(size_t n) { x.resize(n); y.resize(n); z.resize(n); gm.resize(n); }
+};
+
+// Accumulate softened pairwise accelerations from `src` onto `nt` target points.
+// Results are ADDED to ax/ay/az so callers can stack several source sets.
+// A target sitting exactly on a source (e.g. a body and itself) contributes zero,
+// even with eps2 == 0, so the same arrays can be passed as sources and targets.
+void accumulateGravity(const BodyArrays& src,
+                       const double* tx, const double* ty, const double* tz, size_t nt,
+                       double eps2,
+                       double* ax, double* ay, double* az);
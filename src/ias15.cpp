@@ -0,0 +1,265 @@
+#include "ias15.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Gauss-Radau spacings (fractions of the step) for 8 force evaluations
+static const double kH[8] = {
+    0.0,
+    0.0562625605369221464656521910318,
+    0.180240691736892364987579942780,
+    0.352624717113169637373907769648,
+    0.547153626330555383001448554766,
+    0.734210177215410531523210605558,
+    0.885320946839095768090359771030,
+    0.977520613561287501891174488626,
+};
+
+static constexpr int kMaxIterations = 12;     // predictor-corrector passes per step
+static constexpr double kSafety = 0.25;       // reject if dt would shrink below this fraction
+static constexpr double kPcTolerance = 1e-16; // predictor-corrector convergence (relative)
+static constexpr double kMaxPredictRatio = 20.0; // beyond this step ratio the extrapolation is worse than none
+
+// Conversion between the Newton form  a = a0 + g0 t + g1 t(t-h1) + ...  and the
+// power form  a = a0 + b0 t + b1 t^2 + ...  (t in units of the step).
+// kC[k][j] is the coefficient of t^j in (t-h1)(t-h2)...(t-hk), so b_j = sum_k kC[k][j] g_k.
+struct RadauTables {
+    double C[7][7] = {};
+    RadauTables() {
+        double poly[8] = {1.0};
+        for (int k = 0; k < 7; ++k) {
+            if (k > 0) {
+                // poly *= (t - h_k)
+                for (int j = k; j > 0; --j) poly[j] = poly[j - 1] - kH[k] * poly[j];
+                poly[0] = -kH[k] * poly[0];
+            }
+            for (int j = 0; j <= k; ++j) C[k][j] = poly[j];
+        }
+    }
+};
+static const RadauTables kTables;
+
+void iasInit(IASState& s, const std::vector<Particle>& pts, const IASParams& params) {
+    const size_t n = pts.size();
+    s.params = params;
+    s.bodies.resize(n);
+    s.pred.resize(n);
+    s.vx.resize(n); s.vy.resize(n); s.vz.resize(n);
+    for (int k = 0; k < 7; ++k) {
+        s.b[k].assign(3 * n, 0.0);
+        s.g[k].assign(3 * n, 0.0);
+        s.e[k].assign(3 * n, 0.0);
+        s.bPrev[k].assign(3 * n, 0.0);
+        s.ePrev[k].assign(3 * n, 0.0);
+    }
+    s.a0.assign(3 * n, 0.0);
+    s.a.assign(3 * n, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        const Particle& p = pts[i];
+        s.bodies.x[i] = p.pos.x;
+        s.bodies.y[i] = p.pos.y;
+        s.bodies.z[i] = p.pos.z;
+        s.bodies.gm[i] = params.gm * p.mass;
+        s.vx[i] = p.vel.x;
+        s.vy[i] = p.vel.y;
+        s.vz[i] = p.vel.z;
+    }
+    s.pred.gm = s.bodies.gm;
+    s.dt = 0.0;
+    s.dtDone = 0.0;
+    s.steps = 0;
+    s.rejected = 0;
+    s.iterations = 0;
+}
+
+// Acceleration of every body at positions `at`, written to `out` (3N layout)
+static void iasAccel(const IASState& s, const BodyArrays& at, std::vector<double>& out) {
+    const size_t n = at.size();
+    double* ax = out.data();
+    double* ay = ax + n;
+    double* az = ay + n;
+    const double mu = s.params.mu;
+    for (size_t i = 0; i < n; ++i) {
+        double r2 = at.x[i] * at.x[i] + at.y[i] * at.y[i] + at.z[i] * at.z[i];
+        double w = -mu / (r2 * std::sqrt(r2));
+        ax[i] = w * at.x[i];
+        ay[i] = w * at.y[i];
+        az[i] = w * at.z[i];
+    }
+    if (s.params.gm != 0.0)
+        accumulateGravity(at, at.x.data(), at.y.data(), at.z.data(), n, s.params.eps2, ax, ay, az);
+}
+
+// Extrapolate b to a step `q` times the last one (b becomes e + previous correction)
+static void iasPredictNext(IASState& s, const std::vector<double>* from, double q) {
+    if (std::fabs(q) > kMaxPredictRatio) {
+        for (int k = 0; k < 7; ++k) {
+            std::fill(s.b[k].begin(), s.b[k].end(), 0.0);
+            std::fill(s.e[k].begin(), s.e[k].end(), 0.0);
+        }
+        return;
+    }
+    const size_t m = s.b[0].size();
+    const double q2 = q * q, q3 = q2 * q, q4 = q3 * q, q5 = q4 * q, q6 = q5 * q, q7 = q6 * q;
+    for (size_t i = 0; i < m; ++i) {
+        const double b0 = from[0][i], b1 = from[1][i], b2 = from[2][i], b3 = from[3][i];
+        const double b4 = from[4][i], b5 = from[5][i], b6 = from[6][i];
+        double e[7];
+        e[0] = q  * (b6 * 7.0 + b5 * 6.0 + b4 * 5.0 + b3 * 4.0 + b2 * 3.0 + b1 * 2.0 + b0);
+        e[1] = q2 * (b6 * 21.0 + b5 * 15.0 + b4 * 10.0 + b3 * 6.0 + b2 * 3.0 + b1);
+        e[2] = q3 * (b6 * 35.0 + b5 * 20.0 + b4 * 10.0 + b3 * 4.0 + b2);
+        e[3] = q4 * (b6 * 35.0 + b5 * 15.0 + b4 * 5.0 + b3);
+        e[4] = q5 * (b6 * 21.0 + b5 * 6.0 + b4);
+        e[5] = q6 * (b6 * 7.0 + b5);
+        e[6] = q7 * b6;
+        for (int k = 0; k < 7; ++k) {
+            double correction = from[k][i] - s.e[k][i];  // how far off the last prediction was
+            s.e[k][i] = e[k];
+            s.b[k][i] = e[k] + correction;
+        }
+    }
+}
+
+// One attempted step of size dt. Returns false (state untouched, s.dt reduced) on rejection.
+static bool iasStep(IASState& s, double dt) {
+    const size_t n = s.bodies.size();
+    const size_t m = 3 * n;
+    const double* x0[3] = {s.bodies.x.data(), s.bodies.y.data(), s.bodies.z.data()};
+    const double* v0[3] = {s.vx.data(), s.vy.data(), s.vz.data()};
+    double* xp[3] = {s.pred.x.data(), s.pred.y.data(), s.pred.z.data()};
+
+    iasAccel(s, s.bodies, s.a0);
+
+    // Newton form of the warm-start polynomial (back-substitution through kC)
+    for (size_t i = 0; i < m; ++i) {
+        for (int k = 6; k >= 0; --k) {
+            double gk = s.b[k][i];
+            for (int j = k + 1; j < 7; ++j) gk -= kTables.C[j][k] * s.g[j][i];
+            s.g[k][i] = gk;
+        }
+    }
+
+    double maxA = 0.0;
+    double pcLast = 2.0;
+    for (int it = 0; it < kMaxIterations; ++it) {
+        ++s.iterations;
+        double maxDb6 = 0.0;
+        for (int sub = 1; sub < 8; ++sub) {
+            const double h = kH[sub];
+            const double dth = dt * h;
+
+            // Predict positions at t = h*dt from the current polynomial
+            for (int c = 0; c < 3; ++c) {
+                for (size_t i = 0; i < n; ++i) {
+                    const size_t q = c * n + i;
+                    double poly = s.a0[q] / 2.0 + h * (s.b[0][q] / 6.0 + h * (s.b[1][q] / 12.0 + h * (s.b[2][q] / 20.0
+                                + h * (s.b[3][q] / 30.0 + h * (s.b[4][q] / 42.0 + h * (s.b[5][q] / 56.0
+                                + h * s.b[6][q] / 72.0))))));
+                    xp[c][i] = x0[c][i] + dth * v0[c][i] + dth * dth * poly;
+                }
+            }
+            iasAccel(s, s.pred, s.a);
+
+            // Divided differences give the new Newton coefficient g[sub-1]
+            const int k = sub - 1;
+            for (size_t q = 0; q < m; ++q) {
+                double d = (s.a[q] - s.a0[q]) / h;
+                for (int j = 0; j < k; ++j) d = (d - s.g[j][q]) / (h - kH[j + 1]);
+                s.g[k][q] = d;
+
+                // Refresh the power-form coefficients touched by g[k]
+                double b6Old = s.b[6][q];
+                for (int j = 0; j <= k; ++j) {
+                    double bj = 0.0;
+                    for (int kk = j; kk < 7; ++kk) bj += kTables.C[kk][j] * s.g[kk][q];
+                    s.b[j][q] = bj;
+                }
+                if (sub == 7) maxDb6 = std::max(maxDb6, std::fabs(s.b[6][q] - b6Old));
+            }
+        }
+
+        maxA = 0.0;
+        for (size_t q = 0; q < m; ++q) maxA = std::max(maxA, std::fabs(s.a[q]));
+        double pcError = (maxA > 0.0) ? maxDb6 / maxA : 0.0;
+        if (pcError < kPcTolerance) break;
+        if (it > 2 && pcError > pcLast) break;  // no longer converging (round-off floor)
+        pcLast = pcError;
+    }
+
+    // Step-size control from the size of the last coefficient relative to the force
+    double maxB6 = 0.0;
+    for (size_t q = 0; q < m; ++q) maxB6 = std::max(maxB6, std::fabs(s.b[6][q]));
+    double err = (maxA > 0.0) ? maxB6 / maxA : 0.0;
+    double dtNew = (err > 0.0 && std::isfinite(err))
+                 ? dt * std::pow(s.params.epsilon / err, 1.0 / 7.0)
+                 : dt / kSafety;
+    dtNew = std::max(dtNew, s.params.dtMin);
+
+    if (dtNew < kSafety * dt && dt > s.params.dtMin) {
+        // Polynomial did not capture the force well: retry with a smaller step, predicted
+        // from the last accepted step as if its prediction had not happened yet
+        if (s.dtDone > 0.0) {
+            for (int k = 0; k < 7; ++k) s.e[k] = s.ePrev[k];
+            iasPredictNext(s, s.bPrev, dtNew / s.dtDone);
+        } else {
+            for (int k = 0; k < 7; ++k) {
+                std::fill(s.b[k].begin(), s.b[k].end(), 0.0);
+                std::fill(s.e[k].begin(), s.e[k].end(), 0.0);
+            }
+        }
+        s.dt = dtNew;
+        ++s.rejected;
+        return false;
+    }
+    dtNew = std::min(dtNew, dt / kSafety);
+
+    // Accept: evaluate the polynomial at the end of the step
+    double* xs[3] = {s.bodies.x.data(), s.bodies.y.data(), s.bodies.z.data()};
+    double* vs[3] = {s.vx.data(), s.vy.data(), s.vz.data()};
+    for (int c = 0; c < 3; ++c) {
+        for (size_t i = 0; i < n; ++i) {
+            const size_t q = c * n + i;
+            double dx = s.a0[q] / 2.0 + s.b[0][q] / 6.0 + s.b[1][q] / 12.0 + s.b[2][q] / 20.0
+                      + s.b[3][q] / 30.0 + s.b[4][q] / 42.0 + s.b[5][q] / 56.0 + s.b[6][q] / 72.0;
+            double dv = s.a0[q] + s.b[0][q] / 2.0 + s.b[1][q] / 3.0 + s.b[2][q] / 4.0
+                      + s.b[3][q] / 5.0 + s.b[4][q] / 6.0 + s.b[5][q] / 7.0 + s.b[6][q] / 8.0;
+            xs[c][i] += dt * vs[c][i] + dt * dt * dx;
+            vs[c][i] += dt * dv;
+        }
+    }
+
+    for (int k = 0; k < 7; ++k) {
+        s.bPrev[k] = s.b[k];
+        s.ePrev[k] = s.e[k];
+    }
+    iasPredictNext(s, s.bPrev, dtNew / dt);
+    s.dtDone = dt;
+    s.dt = dtNew;
+    ++s.steps;
+    return true;
+}
+
+void iasAdvance(IASState& s, double interval) {
+    if (interval <= 0.0 || s.bodies.size() == 0) return;
+    if (s.dt <= 0.0) s.dt = interval;
+
+    double remaining = interval;
+    while (remaining > 1e-12 * interval) {
+        double dt = std::min(s.dt, remaining);
+        double suggested = s.dt;
+        if (iasStep(s, dt)) {
+            remaining -= dt;
+            // A step cut short to land on the interval end says nothing about
+            // the natural step size, so keep the larger suggestion
+            if (dt < suggested) s.dt = std::max(s.dt, suggested);
+        }
+    }
+}
+
+void iasStore(const IASState& s, std::vector<Particle>& pts) {
+    const size_t n = std::min(pts.size(), s.bodies.size());
+    for (size_t i = 0; i < n; ++i) {
+        pts[i].pos = glm::vec3((float)s.bodies.x[i], (float)s.bodies.y[i], (float)s.bodies.z[i]);
+        pts[i].vel = glm::vec3((float)s.vx[i], (float)s.vy[i], (float)s.vz[i]);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include "gravity.h"
+#include "particle.h"
+
+// IAS15: 15th-order implicit integrator on Gauss-Radau spacings with
+// adaptive step control (Rein & Spiegel 2015). Over each step the
+// acceleration is expanded as a 7th-degree polynomial in time; the
+// coefficients are found by predictor-corrector iteration, and the size of
+// the highest coefficient sets the next step. Close passages shrink the step
+// automatically, smooth stretches grow it, so energy stays at round-off level
+// without hand-tuning dt.
+//
+// Forces: unsoftened central mass at the origin (as in whStep) plus optional
+// softened particle-particle gravity through accumulateGravity.
+struct IASParams {
+    double mu      = 25.0;  // G * Mcentral
+    double gm      = 0.0;   // G per unit particle mass; 0 = massless disk
+    double eps2    = 0.04;  // softening^2 for particle-particle forces only
+    double epsilon = 1e-9;  // step-control tolerance on |b6| / |a|
+    double dtMin   = 1e-9;  // never shrink the step below this
+};
+
+// Per-coefficient arrays hold 3*N doubles laid out as [x0..xN-1, y0..yN-1, z0..zN-1].
+struct IASState {
+    IASParams params;
+    BodyArrays bodies;                  // positions + G*m at step start
+    std::vector<double> vx, vy, vz;     // velocities at step start
+    std::vector<double> b[7];           // polynomial coefficients of a(t)
+    std::vector<double> g[7];           // same polynomial in Newton (divided-difference) form
+    std::vector<double> e[7];           // last prediction of b, to correct the next warm start
+    std::vector<double> bPrev[7];       // b and e of the last accepted step, before its prediction:
+    std::vector<double> ePrev[7];       // a rejected step restarts its warm start from these
+    std::vector<double> a0;             // acceleration at step start
+    std::vector<double> a;              // acceleration at the current substep
+    BodyArrays pred;                    // predicted positions at the current substep
+    double dt = 0.0;                    // step size suggested by the controller
+    double dtDone = 0.0;                // size of the last accepted step
+    long long steps = 0;                // accepted steps (diagnostics)
+    long long rejected = 0;             // rejected step attempts (diagnostics)
+    long long iterations = 0;           // predictor-corrector passes over all attempts (diagnostics)
+};
+
+void iasInit(IASState& s, const std::vector<Particle>& pts, const IASParams& params); // copy particles in
+void iasAdvance(IASState& s, double interval);      // take as many adaptive steps as needed to cover `interval`
+void iasStore(const IASState& s, std::vector<Particle>& pts); // copy positions/velocities out
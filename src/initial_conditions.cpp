@@ -0,0 +1,428 @@
+#include "initial_conditions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "fastmath.h"
+#include "parallel.h"
+#include "philox.h"
+
+// Particles are generated in fixed-size groups: draw all random numbers,
+// run the transcendental math over plain arrays (vectorizable), then write
+// the structs. Group boundaries do not affect the result.
+static constexpr size_t kGenGroup = 16;
+
+// Below this many particles per thread, generate on the calling thread
+static constexpr size_t kMinGenPerThread = 65536;
+
+// Philox stream ids, one per kind of draw, so that new draws can be added later
+// without shifting existing ones
+static constexpr uint32_t kStreamDisk = 0;
+
+std::vector<Particle> makeDiskGalaxy(size_t n, uint64_t seed) {
+    std::vector<Particle> pts(n);
+    makeDiskGalaxyRange(0, n, seed, pts.data());
+    return pts;
+}
+
+void makeDiskGalaxyRange(size_t first, size_t count, uint64_t seed, Particle* out) {
+    const float Rmax = 8.0f;   // disk radius
+    const float vScale = 2.0f; // overall velocity scale
+    const float zSigma = 0.2f; // thin disk thickness
+    const float twoPi = 6.28318530717958648f;
+    const glm::vec3 inner(0.8f, 0.6f, 1.0f); // magenta-ish
+    const glm::vec3 outer(1.0f, 0.8f, 0.2f); // golden
+
+    parallelFor(count, kMinGenPerThread, [&](size_t begin, size_t end) {
+        for (size_t g0 = begin; g0 < end; g0 += kGenGroup) {
+            const size_t ng = (end - g0 < kGenGroup) ? end - g0 : kGenGroup;
+            float r[kGenGroup], ca[kGenGroup], sa[kGenGroup], z[kGenGroup];
+
+            for (size_t l = 0; l < kGenGroup; ++l) {
+                Philox4 rnd = philox4x32(seed, first + g0 + l, kStreamDisk);
+                float u = philoxUniform(rnd.v[0]);
+                float ua = philoxUniform(rnd.v[1]);
+                float b1 = philoxUniform(rnd.v[2]);
+                float b2 = philoxUniform(rnd.v[3]);
+
+                // Radial distribution: more stars toward the center using an exponential profile
+                // r ~ -Rmax * ln(1 - u), clamped to Rmax
+                r[l] = std::fmin(-Rmax * fastLog(1.0f - std::fmax(u, 1e-4f)), Rmax);
+                fastSinCos(ua * twoPi, sa[l], ca[l]);
+
+                // Box-Muller for the vertical offset (1 - b1 keeps the log argument > 0)
+                float s2, c2;
+                fastSinCos(b2 * twoPi, s2, c2);
+                z[l] = zSigma * std::sqrt(-2.0f * fastLog(1.0f - b1)) * c2;
+            }
+
+            for (size_t l = 0; l < ng; ++l) {
+                glm::vec3 pos(r[l] * ca[l], r[l] * sa[l], z[l]);
+
+                // Tangential unit vector (perpendicular to radial)
+                glm::vec3 tangential(-sa[l], ca[l], 0.0f);
+
+                // Rough orbital speed that falls off with radius (softened)
+                float vtheta = vScale / std::sqrt(r[l] + 0.2f);
+                glm::vec3 vel = vtheta * tangential;
+
+                // Color gradient: inner stars bluish/magenta, outer more golden
+                float t = glm::clamp(r[l] / Rmax, 0.0f, 1.0f);
+                glm::vec3 col = glm::mix(inner, outer, t);
+
+                out[g0 + l] = {pos, col, vel, 1.0f};
+            }
+        }
+    });
+}
+
+// ───────────────────────────────────────────────────────────
+// Equilibrium galaxy models
+// ───────────────────────────────────────────────────────────
+
+static constexpr size_t kRadialBins = 512;  // log-spaced radii shared by all tables
+static constexpr size_t kSpeedBins = 128;   // v / v_esc bins per velocity CDF row
+static constexpr double kRadialMin = 1e-3;
+
+static constexpr uint32_t kStreamPosition = 1;
+static constexpr uint32_t kStreamVelocity = 2;
+
+// Unnormalized density of a spherical profile (zero beyond truncation)
+static double profileDensity(const SphericalComponent& c, double r) {
+    if (r > c.rmax) return 0.0;
+    double x = r / c.scale;
+    switch (c.kind) {
+        case ProfileKind::Plummer:   return std::pow(1.0 + x * x, -2.5);
+        case ProfileKind::Hernquist: return 1.0 / (x * (1.0 + x) * (1.0 + x) * (1.0 + x));
+        case ProfileKind::NFW:       return 1.0 / (x * (1.0 + x) * (1.0 + x));
+    }
+    return 0.0;
+}
+
+// Mass inside r for a truncated exponential disk (spherical approximation for the potential)
+static double diskEnclosed(const DiskComponent& d, double r) {
+    double x = std::min(r, d.rmax) / d.scaleLength;
+    double xm = d.rmax / d.scaleLength;
+    double norm = 1.0 - (1.0 + xm) * std::exp(-xm);
+    return d.mass * (1.0 - (1.0 + x) * std::exp(-x)) / norm;
+}
+
+// Piecewise-linear inverse of a monotonic table: find x where cdf(x) = u
+static double sampleTable(const double* xs, const double* cdf, size_t n, double u) {
+    const double* it = std::upper_bound(cdf, cdf + n, u);
+    size_t k = (size_t)(it - cdf);
+    if (k == 0) return xs[0] * (cdf[0] > 0.0 ? u / cdf[0] : 0.0);
+    if (k >= n) return xs[n - 1];
+    double span = cdf[k] - cdf[k - 1];
+    double t = span > 0.0 ? (u - cdf[k - 1]) / span : 0.0;
+    return xs[k - 1] + t * (xs[k] - xs[k - 1]);
+}
+
+// Radius bracket in the log grid: r lies between radii[k] and radii[k+1] at fraction t
+static void radialBracket(const std::vector<double>& radii, double r, size_t& k, double& t) {
+    size_t hi = (size_t)(std::upper_bound(radii.begin(), radii.end(), r) - radii.begin());
+    if (hi == 0) { k = 0; t = 0.0; return; }
+    if (hi >= radii.size()) { k = radii.size() - 2; t = 1.0; return; }
+    k = hi - 1;
+    t = (r - radii[k]) / (radii[k + 1] - radii[k]);
+}
+
+// Shared radial grid with the total enclosed mass and relative potential Psi = -Phi
+struct PotentialTable {
+    std::vector<double> r, mass, psi;
+
+    double psiAt(double x) const {
+        size_t k; double t;
+        radialBracket(r, x, k, t);
+        return psi[k] + t * (psi[k + 1] - psi[k]);
+    }
+    // Circular speed^2 in the midplane, from the (spherical) enclosed mass
+    double vc2At(const GalaxyModel& m, double x) const {
+        size_t k; double t;
+        radialBracket(r, x, k, t);
+        double menc = mass[k] + t * (mass[k + 1] - mass[k]);
+        double rs2 = x * x + m.eps2;
+        return m.G * menc / x + m.mu * x * x / (rs2 * std::sqrt(rs2));
+    }
+    // Epicyclic frequency^2, kappa^2 = R dOmega^2/dR + 4 Omega^2, differencing Omega^2 = vc^2 / R^2
+    // across one (logarithmic) grid spacing
+    double kappa2At(const GalaxyModel& m, double x) const {
+        double s = std::sqrt(r[1] / r[0]);
+        double lo = x / s, hi = x * s;
+        double dOmega2 = (vc2At(m, hi) / (hi * hi) - vc2At(m, lo) / (lo * lo)) / (hi - lo);
+        return std::max(x * dOmega2 + 4.0 * vc2At(m, x) / (x * x), 0.0);
+    }
+};
+
+static PotentialTable buildPotential(const GalaxyModel& m) {
+    double rOuter = 1.0;
+    for (const auto& c : m.spheres) rOuter = std::max(rOuter, c.rmax);
+    for (const auto& d : m.disks) rOuter = std::max(rOuter, d.rmax);
+    rOuter *= 1.05;
+
+    PotentialTable P;
+    P.r.resize(kRadialBins);
+    P.mass.assign(kRadialBins, 0.0);
+    P.psi.resize(kRadialBins);
+    double lnMin = std::log(kRadialMin), lnMax = std::log(rOuter);
+    for (size_t k = 0; k < kRadialBins; ++k)
+        P.r[k] = std::exp(lnMin + (lnMax - lnMin) * k / (kRadialBins - 1));
+
+    // Enclosed mass: integrate each spherical profile, then scale it to its total
+    for (const auto& c : m.spheres) {
+        std::vector<double> mc(kRadialBins);
+        mc[0] = 4.0 / 3.0 * 3.14159265358979 * P.r[0] * P.r[0] * P.r[0] * profileDensity(c, P.r[0]);
+        for (size_t k = 1; k < kRadialBins; ++k) {
+            double f0 = P.r[k - 1] * P.r[k - 1] * profileDensity(c, P.r[k - 1]);
+            double f1 = P.r[k] * P.r[k] * profileDensity(c, P.r[k]);
+            mc[k] = mc[k - 1] + 2.0 * 3.14159265358979 * (f0 + f1) * (P.r[k] - P.r[k - 1]);
+        }
+        double total = mc.back() > 0.0 ? mc.back() : 1.0;
+        for (size_t k = 0; k < kRadialBins; ++k) P.mass[k] += c.mass * mc[k] / total;
+    }
+    for (const auto& d : m.disks)
+        for (size_t k = 0; k < kRadialBins; ++k) P.mass[k] += diskEnclosed(d, P.r[k]);
+
+    // Psi(r) = G [M(r)/r + integral_r^inf dM/r'] + central term
+    double outer = 0.0;
+    for (size_t k = kRadialBins; k-- > 0;) {
+        if (k + 1 < kRadialBins)
+            outer += (P.mass[k + 1] - P.mass[k]) / (0.5 * (P.r[k] + P.r[k + 1]));
+        double rs = std::sqrt(P.r[k] * P.r[k] + m.eps2);
+        P.psi[k] = m.G * (P.mass[k] / P.r[k] + outer) + m.mu / rs;
+    }
+    return P;
+}
+
+// Sampling tables for one spherical component
+struct SphereTables {
+    std::vector<double> massCdf;  // own enclosed mass / total, per radius
+    std::vector<double> speedQ;   // v / v_esc at bin edges (shared by all rows)
+    std::vector<double> speedCdf; // kRadialBins rows of (kSpeedBins + 1) entries
+};
+
+// Eddington inversion: f(eps) = 1/(sqrt(8) pi^2) d/d(eps) int_0^eps (dnu/dPsi) dPsi / sqrt(eps - Psi).
+// With nu(Psi) piecewise linear between grid points the inner integral is exact per segment.
+static std::vector<double> eddington(const PotentialTable& P, const std::vector<double>& nu) {
+    const size_t K = kRadialBins;
+    std::vector<double> slope(K, 0.0), F(K, 0.0), f(K, 0.0);
+    for (size_t k = 0; k + 1 < K; ++k) {
+        double dpsi = P.psi[k] - P.psi[k + 1];
+        slope[k] = dpsi > 0.0 ? (nu[k] - nu[k + 1]) / dpsi : 0.0;
+    }
+    for (size_t j = 0; j < K; ++j) {
+        double eps = P.psi[j], sum = 0.0;
+        for (size_t k = j; k + 1 < K; ++k)
+            sum += 2.0 * slope[k] * (std::sqrt(eps - P.psi[k + 1]) - std::sqrt(std::max(eps - P.psi[k], 0.0)));
+        F[j] = sum;
+    }
+    for (size_t j = 0; j < K; ++j) {
+        size_t a = (j == 0) ? 0 : j - 1;
+        size_t b = (j + 1 < K) ? j + 1 : K - 1;
+        double de = P.psi[a] - P.psi[b];
+        f[j] = de > 0.0 ? std::max((F[a] - F[b]) / de, 0.0) : 0.0;  // normalization is irrelevant
+    }
+    return f;
+}
+
+// f(eps) from the table (eps descends with the grid index)
+static double dfAt(const PotentialTable& P, const std::vector<double>& f, double eps) {
+    const size_t K = kRadialBins;
+    if (eps >= P.psi[0]) return f[0];
+    if (eps <= P.psi[K - 1]) return f[K - 1] * std::max(eps, 0.0) / P.psi[K - 1];
+    // First index whose psi is below eps
+    size_t lo = 0, hi = K - 1;
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (P.psi[mid] > eps) lo = mid; else hi = mid;
+    }
+    double t = (P.psi[lo] - eps) / (P.psi[lo] - P.psi[hi]);
+    return f[lo] + t * (f[hi] - f[lo]);
+}
+
+static SphereTables buildSphereTables(const SphericalComponent& c, const PotentialTable& P) {
+    const size_t K = kRadialBins, Q = kSpeedBins + 1;
+    SphereTables T;
+
+    std::vector<double> nu(K);
+    for (size_t k = 0; k < K; ++k) nu[k] = profileDensity(c, P.r[k]);
+
+    T.massCdf.resize(K);
+    T.massCdf[0] = P.r[0] * P.r[0] * P.r[0] * nu[0] / 3.0;
+    for (size_t k = 1; k < K; ++k)
+        T.massCdf[k] = T.massCdf[k - 1] + 0.5 * (P.r[k - 1] * P.r[k - 1] * nu[k - 1] + P.r[k] * P.r[k] * nu[k]) * (P.r[k] - P.r[k - 1]);
+    double total = T.massCdf.back() > 0.0 ? T.massCdf.back() : 1.0;
+    for (double& v : T.massCdf) v /= total;
+
+    // Speed CDF at each radius: p(q) ~ q^2 f(Psi (1 - q^2)), q = v / v_esc
+    std::vector<double> f = eddington(P, nu);
+    T.speedQ.resize(Q);
+    for (size_t j = 0; j < Q; ++j) T.speedQ[j] = (double)j / kSpeedBins;
+    T.speedCdf.resize(K * Q);
+    parallelFor(K, 32, [&](size_t b, size_t e) {
+        for (size_t k = b; k < e; ++k) {
+            double* row = &T.speedCdf[k * Q];
+            double prev = 0.0;
+            row[0] = 0.0;
+            for (size_t j = 1; j < Q; ++j) {
+                double q = T.speedQ[j];
+                double w = q * q * dfAt(P, f, P.psi[k] * (1.0 - q * q));
+                row[j] = row[j - 1] + 0.5 * (prev + w) / kSpeedBins;
+                prev = w;
+            }
+            double norm = row[Q - 1];
+            for (size_t j = 0; j < Q; ++j)
+                row[j] = norm > 0.0 ? row[j] / norm : (double)j / (Q - 1);  // degenerate: uniform q
+        }
+    });
+    return T;
+}
+
+// Uniform direction on the unit sphere from two uniforms
+static glm::vec3 isotropic(float u, float w) {
+    float cz = 2.0f * u - 1.0f;
+    float sz = std::sqrt(std::max(0.0f, 1.0f - cz * cz));
+    float s, c;
+    fastSinCos(w * 6.28318530717958648f, s, c);
+    return glm::vec3(sz * c, sz * s, cz);
+}
+
+static void sampleSphere(const SphericalComponent& comp, const SphereTables& T, const PotentialTable& P,
+                         uint64_t seed, size_t first, Particle* out) {
+    const size_t Q = kSpeedBins + 1;
+    parallelFor(comp.count, kMinGenPerThread / 4, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            const uint64_t id = first + i;
+            Philox4 rp = philox4x32(seed, id, kStreamPosition);
+            Philox4 rv = philox4x32(seed, id, kStreamVelocity);
+
+            double r = sampleTable(P.r.data(), T.massCdf.data(), kRadialBins, philoxUniform(rp.v[0]));
+            glm::vec3 pos = (float)r * isotropic(philoxUniform(rp.v[1]), philoxUniform(rp.v[2]));
+
+            // Pick one of the two bracketing speed rows with probability by distance (stochastic interpolation)
+            size_t k; double t;
+            radialBracket(P.r, r, k, t);
+            size_t row = (philoxUniform(rp.v[3]) < t) ? k + 1 : k;
+            double q = sampleTable(T.speedQ.data(), &T.speedCdf[row * Q], Q, philoxUniform(rv.v[0]));
+            double v = q * std::sqrt(2.0 * P.psiAt(r));
+            glm::vec3 vel = (float)v * isotropic(philoxUniform(rv.v[1]), philoxUniform(rv.v[2]));
+
+            out[i] = {pos, comp.color, vel, (float)(comp.mass / comp.count)};
+        }
+    });
+}
+
+static void sampleDisk(const DiskComponent& d, const GalaxyModel& m, const PotentialTable& P,
+                       uint64_t seed, size_t first, Particle* out) {
+    // Radial CDF of the truncated exponential profile on the shared grid
+    std::vector<double> cdf(kRadialBins);
+    for (size_t k = 0; k < kRadialBins; ++k) cdf[k] = diskEnclosed(d, P.r[k]) / d.mass;
+
+    const double Rd = d.scaleLength;
+    const double sigma0 = d.sigmaR0 * std::sqrt(P.vc2At(m, Rd));
+    const glm::vec3 inner(0.8f, 0.6f, 1.0f); // magenta-ish
+    const glm::vec3 outer(1.0f, 0.8f, 0.2f); // golden
+
+    parallelFor(d.count, kMinGenPerThread / 4, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            const uint64_t id = first + i;
+            Philox4 rp = philox4x32(seed, id, kStreamPosition);
+            Philox4 rv = philox4x32(seed, id, kStreamVelocity);
+
+            double R = std::max(sampleTable(P.r.data(), cdf.data(), kRadialBins, philoxUniform(rp.v[0])), kRadialMin);
+            float sa, ca;
+            fastSinCos(philoxUniform(rp.v[1]) * 6.28318530717958648f, sa, ca);
+
+            // Two Box-Muller pairs -> four unit normals
+            float s1, c1, s2, c2;
+            fastSinCos(philoxUniform(rv.v[1]) * 6.28318530717958648f, s1, c1);
+            fastSinCos(philoxUniform(rv.v[3]) * 6.28318530717958648f, s2, c2);
+            float m1 = std::sqrt(-2.0f * fastLog(1.0f - philoxUniform(rv.v[0])));
+            float m2 = std::sqrt(-2.0f * fastLog(1.0f - philoxUniform(rv.v[2])));
+            float n0 = m1 * c1, n1 = m1 * s1, n2 = m2 * c2, n3 = m2 * s2;
+
+            // Vertical: Gaussian layer; sigma_z = h * nu_z with nu_z ~ Omega (point-mass dominated)
+            double vc2 = P.vc2At(m, R);
+            double omega = std::sqrt(vc2) / R;
+            double z = d.scaleHeight * n0;
+            double sigmaZ = d.scaleHeight * omega;
+
+            // In-plane: sigma_R^2 ~ exp(-R/Rd), sigma_phi^2 / sigma_R^2 = kappa^2 / (4 Omega^2) (epicycle
+            // approximation: 1/4 around the point mass, 1/2 on a flat rotation curve), mean rotation lowered by
+            // the asymmetric drift  vc^2 - vphi^2 = sigma_R^2 (sigma_phi^2 / sigma_R^2 - 1 + 2R/Rd)
+            double sigmaR = sigma0 * std::exp(-0.5 * R / Rd);
+            double phiRatio = std::min(P.kappa2At(m, R) * R * R / (4.0 * vc2), 1.0);
+            double vphi = std::sqrt(std::max(vc2 - sigmaR * sigmaR * (phiRatio - 1.0 + 2.0 * R / Rd), 0.0));
+            double vR = sigmaR * n1;
+            double vT = vphi + sigmaR * std::sqrt(phiRatio) * n2;
+            double vz = sigmaZ * n3;
+
+            glm::vec3 pos((float)R * ca, (float)R * sa, (float)z);
+            glm::vec3 vel((float)(vR * ca - vT * sa), (float)(vR * sa + vT * ca), (float)vz);
+
+            // Same radial color gradient as makeDiskGalaxy
+            float t = glm::clamp((float)(R / d.rmax), 0.0f, 1.0f);
+            out[i] = {pos, glm::mix(inner, outer, t), vel, (float)(d.mass / d.count)};
+        }
+    });
+}
+
+std::vector<Particle> makeGalaxy(const GalaxyModel& model, uint64_t seed) {
+    size_t total = 0;
+    for (const auto& c : model.spheres) total += c.count;
+    for (const auto& d : model.disks) total += d.count;
+    std::vector<Particle> pts(total);
+
+    PotentialTable P = buildPotential(model);
+    size_t first = 0;
+    for (const auto& c : model.spheres) {
+        if (c.count == 0) continue;
+        SphereTables T = buildSphereTables(c, P);
+        sampleSphere(c, T, P, seed, first, pts.data() + first);
+        first += c.count;
+    }
+    for (const auto& d : model.disks) {
+        if (d.count == 0) continue;
+        sampleDisk(d, model, P, seed, first, pts.data() + first);
+        first += d.count;
+    }
+    return pts;
+}
+
+bool galaxyPreset(const char* name, size_t n, GalaxyModel& out) {
+    out = GalaxyModel{};
+    std::string s(name);
+    if (s == "plummer") {
+        SphericalComponent c;
+        c.kind = ProfileKind::Plummer; c.scale = 2.0; c.rmax = 20.0; c.count = n;
+        c.color = glm::vec3(1.0f, 0.85f, 0.6f);
+        out.spheres.push_back(c);
+    } else if (s == "hernquist") {
+        SphericalComponent c;
+        c.kind = ProfileKind::Hernquist; c.scale = 1.5; c.rmax = 20.0; c.count = n;
+        c.color = glm::vec3(1.0f, 0.8f, 0.5f);
+        out.spheres.push_back(c);
+    } else if (s == "nfw") {
+        SphericalComponent c;
+        c.kind = ProfileKind::NFW; c.scale = 2.0; c.rmax = 20.0; c.count = n;
+        c.color = glm::vec3(0.5f, 0.6f, 1.0f);
+        out.spheres.push_back(c);
+    } else if (s == "galaxy") {
+        // Bulge + disk + halo, by particle share 15% / 60% / 25%
+        SphericalComponent bulge;
+        bulge.kind = ProfileKind::Hernquist; bulge.scale = 0.5; bulge.rmax = 6.0;
+        bulge.count = n * 15 / 100; bulge.color = glm::vec3(1.0f, 0.75f, 0.45f);
+        SphericalComponent halo;
+        halo.kind = ProfileKind::NFW; halo.scale = 6.0; halo.rmax = 20.0;
+        halo.count = n * 25 / 100; halo.color = glm::vec3(0.35f, 0.4f, 0.8f);
+        DiskComponent disk;
+        disk.count = n - bulge.count - halo.count;
+        out.spheres.push_back(bulge);
+        out.spheres.push_back(halo);
+        out.disks.push_back(disk);
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "particle.h"
+
+// Initialize a simple disk galaxy: particles distributed in a thin disk with
+// tangential (orbital) velocities around the origin, colored by radius.
+// Particle i depends only on (seed, i), and the work is spread over all
+// cores, so the same seed reproduces the same disk bit for bit on any
+// thread count.
+std::vector<Particle> makeDiskGalaxy(size_t n, uint64_t seed);
+
+// Particles [first, first + count) of that disk, written to out[0, count).
+// Lets a disk larger than memory be generated one piece at a time.
+void makeDiskGalaxyRange(size_t first, size_t count, uint64_t seed, Particle* out);
+
+// ───────────────────────────────────────────────────────────
+// Equilibrium galaxy models
+// ───────────────────────────────────────────────────────────
+// Spherical components are sampled from their isotropic distribution
+// function f(E), obtained by Eddington inversion in the TOTAL potential
+// (central mass + all components). Disks are exponential in R, Gaussian in z,
+// with velocities from the Jeans equations (asymmetric drift + epicyclic
+// dispersions). All sampling goes through precomputed CDF tables and binary
+// search, and every particle is drawn from Philox keyed by (seed, index).
+
+enum class ProfileKind {
+    Plummer,   // rho ~ (1 + r^2/a^2)^(-5/2)
+    Hernquist, // rho ~ 1 / ((r/a) (1 + r/a)^3)
+    NFW        // rho ~ 1 / ((r/a) (1 + r/a)^2), truncated at rmax
+};
+
+struct SphericalComponent {
+    ProfileKind kind = ProfileKind::Plummer;
+    double mass  = 1.0;  // total mass (only matters for the potential when G > 0)
+    double scale = 1.0;  // scale radius a
+    double rmax  = 20.0; // truncation radius
+    size_t count = 0;    // number of particles
+    glm::vec3 color = glm::vec3(1.0f);
+};
+
+struct DiskComponent {
+    double mass         = 1.0;  // total mass (only matters for the potential when G > 0)
+    double scaleLength  = 2.5;  // exponential scale length Rd
+    double scaleHeight  = 0.2;  // Gaussian vertical scale
+    double rmax         = 8.0;  // truncation radius
+    double sigmaR0      = 0.1;  // central radial dispersion, in units of vc(Rd)
+    size_t count = 0;
+};
+
+// A galaxy is a central point mass plus any number of components.
+// With G = 0 the components are massless tracers (as every particle is in
+// stepParticles) and only the central mass shapes their orbits.
+struct GalaxyModel {
+    double mu   = 25.0; // G * Mcentral (same as stepParticles)
+    double eps2 = 0.04; // central softening^2 (same as stepParticles)
+    double G    = 0.0;  // gravitational constant applied to component masses
+    std::vector<SphericalComponent> spheres;
+    std::vector<DiskComponent> disks;
+};
+
+// Sample all components; particles are ordered spheres first, then disks
+std::vector<Particle> makeGalaxy(const GalaxyModel& model, uint64_t seed);
+
+// Ready-made models ("plummer", "hernquist", "nfw", "galaxy") with n particles
+// in total. Returns false for an unknown name.
+bool galaxyPreset(const char* name, size_t n, GalaxyModel& out);
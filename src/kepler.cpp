@@ -0,0 +1,160 @@
+#include "kepler.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Laguerre-Conway passes per group: it converges cubically and almost
+// globally, so with whole periods removed from the step and the starting
+// guesses below a few passes reach round-off. A group iterates until every
+// lane's residual is below kKeplerTol (relative to sqrt(mu) * t); lanes still
+// unconverged after kKeplerMaxIters are redone as two half steps.
+static constexpr int kKeplerMaxIters = 40;
+static constexpr double kKeplerTol = 1e-13;
+static constexpr int kKeplerMaxSplits = 16; // half-step depth before accepting the last iterate
+
+// Stumpff functions c2(z), c3(z) without data-dependent branches: all three
+// forms (series / trigonometric / hyperbolic) are evaluated and the right one
+// is selected, which compiles to blends inside the lane loops.
+static inline void stumpff(double z, double& c2, double& c3) {
+    // Taylor series, accurate for small |z|
+    double s2 = 0.5 - z * (1.0 / 24.0 - z * (1.0 / 720.0 - z * (1.0 / 40320.0 - z / 3628800.0)));
+    double s3 = 1.0 / 6.0 - z * (1.0 / 120.0 - z * (1.0 / 5040.0 - z * (1.0 / 362880.0 - z / 39916800.0)));
+
+    double az = std::fabs(z) + 1e-300;               // avoid 0/0 in the unused forms
+    double s = std::min(std::sqrt(az), 700.0);       // keep exp() finite for wild hyperbolae
+    double inv = 1.0 / az;
+
+    // Elliptic (z > 0)
+    double e2 = (1.0 - std::cos(s)) * inv;
+    double e3 = (s - std::sin(s)) * inv / s;
+
+    // Hyperbolic (z < 0)
+    double ex = std::exp(s), exi = 1.0 / ex;
+    double h2 = (0.5 * (ex + exi) - 1.0) * inv;
+    double h3 = (0.5 * (ex - exi) - s) * inv / s;
+
+    bool small = az < 0.1;
+    c2 = small ? s2 : (z > 0.0 ? e2 : h2);
+    c3 = small ? s3 : (z > 0.0 ? e3 : h3);
+}
+
+static void drift(double* x, double* y, double* z, double* vx, double* vy, double* vz, size_t n, double mu, double dt,
+                  int depth) {
+    const double smu = std::sqrt(mu);
+
+    for (size_t i0 = 0; i0 < n; i0 += kKeplerLanes) {
+        const size_t nb = std::min(kKeplerLanes, n - i0);
+
+        // Gather the group; padded lanes get a harmless circular orbit
+        double rx[kKeplerLanes], ry[kKeplerLanes], rz[kKeplerLanes];
+        double ux[kKeplerLanes], uy[kKeplerLanes], uz[kKeplerLanes];
+        for (size_t l = 0; l < kKeplerLanes; ++l) {
+            bool live = l < nb;
+            rx[l] = live ? x[i0 + l] : 1.0;
+            ry[l] = live ? y[i0 + l] : 0.0;
+            rz[l] = live ? z[i0 + l] : 0.0;
+            ux[l] = live ? vx[i0 + l] : 0.0;
+            uy[l] = live ? vy[i0 + l] : smu;
+            uz[l] = live ? vz[i0 + l] : 0.0;
+        }
+
+        // Orbit invariants per lane
+        double r0[kKeplerLanes], sig0[kKeplerLanes], alpha[kKeplerLanes], X[kKeplerLanes];
+        double tdrift[kKeplerLanes];
+        for (size_t l = 0; l < kKeplerLanes; ++l) {
+            r0[l] = std::sqrt(rx[l] * rx[l] + ry[l] * ry[l] + rz[l] * rz[l]);
+            double v2 = ux[l] * ux[l] + uy[l] * uy[l] + uz[l] * uz[l];
+            sig0[l] = (rx[l] * ux[l] + ry[l] * uy[l] + rz[l] * uz[l]) / smu;
+            alpha[l] = 2.0 / r0[l] - v2 / mu;  // 1/a (negative for unbound orbits)
+
+            // Bound orbits: drop whole periods so the solve never spans more than one orbit
+            bool bound = alpha[l] > 0.0;
+            double period = 2.0 * 3.14159265358979323846 / (smu * std::pow(std::fabs(alpha[l]), 1.5) + 1e-300);
+            double tred = bound ? dt - period * std::floor(dt / period) : dt;
+            tdrift[l] = tred;
+
+            // Starting guess: local rate sqrt(mu)/r0 for short steps, mean rate sqrt(mu)*alpha
+            // once the step covers a sizeable fraction of the orbit. Unbound orbits over long
+            // steps use the asymptotic hyperbolic guess (Vallado, Algorithm 8), since X grows
+            // only logarithmically with t there
+            bool longStep = bound && tred > 0.1 * period;
+            double a = 1.0 / (alpha[l] - 1e-300);   // < 0 when unbound
+            double st = tred < 0.0 ? -1.0 : 1.0;
+            double hypArg = -2.0 * mu * alpha[l] * tred /
+                            (sig0[l] * smu + st * std::sqrt(std::fabs(mu * a)) * (1.0 - r0[l] * alpha[l]));
+            bool hypLong = alpha[l] < 0.0 && hypArg > 1.0;
+            double hypGuess = st * std::sqrt(std::fabs(a)) * std::log(hypLong ? hypArg : 1.0);
+            X[l] = longStep ? smu * tred * alpha[l] : (hypLong ? hypGuess : smu * tred / r0[l]);
+        }
+
+        // Solve r0*G1 + sig0*G2 + G3 = sqrt(mu)*t for the universal anomaly X
+        bool converged[kKeplerLanes] = {};
+        for (int it = 0; it < kKeplerMaxIters; ++it) {
+            bool all = true;
+            for (size_t l = 0; l < kKeplerLanes; ++l) {
+                double c2, c3;
+                double zz = alpha[l] * X[l] * X[l];
+                stumpff(zz, c2, c3);
+                double G0 = 1.0 - zz * c2;
+                double G1 = X[l] * (1.0 - zz * c3);
+                double G2 = X[l] * X[l] * c2;
+                double G3 = X[l] * X[l] * X[l] * c3;
+
+                double F = r0[l] * G1 + sig0[l] * G2 + G3 - smu * tdrift[l];
+                double Fp = r0[l] * G0 + sig0[l] * G1 + G2;           // = r(X) > 0
+                double Fpp = (1.0 - alpha[l] * r0[l]) * G1 + sig0[l] * G0;
+
+                // Laguerre-Conway update with n = 5 (converged lanes keep their X)
+                converged[l] = std::fabs(F) <= kKeplerTol * (smu * std::fabs(tdrift[l]) + r0[l]);
+                all = all && converged[l];
+                double disc = std::fabs(16.0 * Fp * Fp - 20.0 * F * Fpp);
+                double denom = Fp + std::copysign(std::sqrt(disc), Fp);
+                X[l] = converged[l] ? X[l] : X[l] - 5.0 * F / denom;
+            }
+            if (all) break;
+        }
+
+        // Gauss f and g functions map (r0, v0) -> (r, v)
+        for (size_t l = 0; l < kKeplerLanes; ++l) {
+            double c2, c3;
+            double zz = alpha[l] * X[l] * X[l];
+            stumpff(zz, c2, c3);
+            double G0 = 1.0 - zz * c2;
+            double G1 = X[l] * (1.0 - zz * c3);
+            double G2 = X[l] * X[l] * c2;
+            double G3 = X[l] * X[l] * X[l] * c3;
+            double r = r0[l] * G0 + sig0[l] * G1 + G2;
+
+            double f = 1.0 - G2 / r0[l];
+            double g = tdrift[l] - G3 / smu;
+            double fd = -smu * G1 / (r * r0[l]);
+            double gd = 1.0 - G2 / r;
+
+            double nx = f * rx[l] + g * ux[l];
+            double ny = f * ry[l] + g * uy[l];
+            double nz = f * rz[l] + g * uz[l];
+            ux[l] = fd * rx[l] + gd * ux[l];
+            uy[l] = fd * ry[l] + gd * uy[l];
+            uz[l] = fd * rz[l] + gd * uz[l];
+            rx[l] = nx; ry[l] = ny; rz[l] = nz;
+        }
+
+        for (size_t l = 0; l < nb; ++l) {
+            const size_t i = i0 + l;
+            if (!converged[l] && depth < kKeplerMaxSplits) {
+                // Shorter steps start closer to the root: redo this orbit as two halves
+                drift(x + i, y + i, z + i, vx + i, vy + i, vz + i, 1, mu, 0.5 * dt, depth + 1);
+                drift(x + i, y + i, z + i, vx + i, vy + i, vz + i, 1, mu, 0.5 * dt, depth + 1);
+                continue;
+            }
+            x[i] = rx[l];  y[i] = ry[l];  z[i] = rz[l];
+            vx[i] = ux[l]; vy[i] = uy[l]; vz[i] = uz[l];
+        }
+    }
+}
+
+void keplerDrift(double* x, double* y, double* z,
+                 double* vx, double* vy, double* vz,
+                 size_t n, double mu, double dt) {
+    drift(x, y, z, vx, vy, vz, n, mu, dt, 0);
+}
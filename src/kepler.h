@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// Number of orbits advanced together by the Kepler solver. A group iterates
+// until all of its lanes have converged, with lanes updated by selects rather
+// than branches, so it maps onto 8 double lanes (AVX-512) or two AVX2
+// registers. A lane that does not converge is redone in two half steps.
+static constexpr size_t kKeplerLanes = 8;
+
+// Advance `n` two-body orbits about a fixed mass `mu` (= G * M) by `dt`,
+// in place, using universal variables (valid for elliptic, parabolic and
+// hyperbolic orbits alike). Arrays are structure-of-arrays, one per component.
+void keplerDrift(double* x, double* y, double* z,
+                 double* vx, double* vy, double* vz,
+                 size_t n, double mu, double dt);
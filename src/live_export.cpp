@@ -0,0 +1,262 @@
+#include "live_export.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include "parallel.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr size_t kLivePage = 4096; // header page; slots are page aligned after it
+
+// Below this many particles per thread, gather on the calling thread
+static constexpr size_t kMinPublishPerThread = 65536;
+
+static size_t alignUp(size_t v, size_t a) { return (v + a - 1) / a * a; }
+
+// Column offsets inside a slot; each column starts on a cache line
+static size_t posOffset() { return alignUp(sizeof(LiveSlot), 64); }
+static size_t velOffset(size_t capacity) { return posOffset() + alignUp(capacity * 3 * sizeof(float), 64); }
+static size_t massOffset(size_t capacity) { return velOffset(capacity) + alignUp(capacity * 3 * sizeof(float), 64); }
+static size_t slotStride(size_t capacity) { return alignUp(massOffset(capacity) + capacity * sizeof(float), kLivePage); }
+
+static unsigned char* slotAt(const LiveHeader* h, uint64_t frame) {
+    unsigned char* base = reinterpret_cast<unsigned char*>(const_cast<LiveHeader*>(h)) + kLivePage;
+    return base + (size_t)(frame % h->slots) * (size_t)h->slotBytes;
+}
+
+#ifndef _WIN32
+// POSIX shared-memory names are "/name"
+static std::string shmName(const std::string& name) { return name.empty() || name[0] != '/' ? "/" + name : name; }
+#endif
+
+bool LiveExporter::create(const std::string& name, size_t capacity, size_t slots) {
+    close();
+    if (slots < 2) slots = 2;
+    const size_t stride = slotStride(capacity);
+    const size_t total = kLivePage + slots * stride;
+    void* p = nullptr;
+#ifdef _WIN32
+    HANDLE m = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)((unsigned long long)total >> 32),
+                                  (DWORD)total, name.c_str());
+    p = m ? MapViewOfFile(m, FILE_MAP_ALL_ACCESS, 0, 0, 0) : nullptr;
+    if (!p) {
+        std::cerr << "Failed to create shared memory '" << name << "'" << std::endl;
+        if (m) CloseHandle(m);
+        return false;
+    }
+    mappingHandle = m;
+#else
+    // Replace a segment left behind by an earlier run; readers still attached keep the old one
+    const std::string shm = shmName(name);
+    shm_unlink(shm.c_str());
+    int fd = shm_open(shm.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create shared memory '" << shm << "'" << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, (off_t)total) != 0) {
+        std::cerr << "Failed to size shared memory '" << shm << "' to " << total << " bytes" << std::endl;
+        ::close(fd);
+        shm_unlink(shm.c_str());
+        return false;
+    }
+    p = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the segment alive
+    if (p == MAP_FAILED) {
+        std::cerr << "Failed to map shared memory '" << shm << "'" << std::endl;
+        shm_unlink(shm.c_str());
+        return false;
+    }
+    segment = shm;
+#endif
+    bytes = total;
+    header = new (p) LiveHeader();
+    header->version = kLiveVersion;
+    header->slots = (uint32_t)slots;
+    header->capacity = capacity;
+    header->slotBytes = stride;
+    for (size_t i = 0; i < slots; ++i) new (slotAt(header, i)) LiveSlot();
+    // Magic last: a reader that sees it sees a complete header
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, kLiveMagic, sizeof(header->magic));
+    return true;
+}
+
+void LiveExporter::publish(const Particle* pts, size_t count, double time, uint64_t step) {
+    if (!header) return;
+    if (count > header->capacity) count = (size_t)header->capacity;
+    const uint64_t frame = header->published.load(std::memory_order_relaxed);
+    unsigned char* base = slotAt(header, frame);
+    LiveSlot* slot = reinterpret_cast<LiveSlot*>(base);
+
+    // Seqlock write: odd while the slot is inconsistent
+    const uint64_t seq = slot->seq.load(std::memory_order_relaxed);
+    slot->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->frame = frame;
+    slot->time = time;
+    slot->step = step;
+    slot->count = count;
+    float* pos = reinterpret_cast<float*>(base + posOffset());
+    float* vel = reinterpret_cast<float*>(base + velOffset((size_t)header->capacity));
+    float* mass = reinterpret_cast<float*>(base + massOffset((size_t)header->capacity));
+    parallelFor(count, kMinPublishPerThread, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const Particle& p = pts[i];
+            pos[3 * i + 0] = p.pos.x;
+            pos[3 * i + 1] = p.pos.y;
+            pos[3 * i + 2] = p.pos.z;
+            vel[3 * i + 0] = p.vel.x;
+            vel[3 * i + 1] = p.vel.y;
+            vel[3 * i + 2] = p.vel.z;
+            mass[i] = p.mass;
+        }
+    });
+
+    slot->seq.store(seq + 2, std::memory_order_release);
+    header->published.store(frame + 1, std::memory_order_release);
+}
+
+void LiveExporter::close() {
+    if (!header) return;
+    header->closed.store(1, std::memory_order_release);
+#ifdef _WIN32
+    UnmapViewOfFile(header);
+    if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+    mappingHandle = nullptr;
+#else
+    munmap(header, bytes);
+    shm_unlink(segment.c_str()); // attached readers keep their mapping until they detach
+#endif
+    header = nullptr;
+    bytes = 0;
+    segment.clear();
+}
+
+bool LiveReader::attach(const std::string& name) {
+    detach();
+    const void* p = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE m = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    p = m ? MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!p) {
+        std::cerr << "No live export named '" << name << "'" << std::endl;
+        if (m) CloseHandle(m);
+        return false;
+    }
+    MEMORY_BASIC_INFORMATION info;
+    size = VirtualQuery(p, &info, sizeof(info)) ? (size_t)info.RegionSize : 0;
+    mappingHandle = m;
+#else
+    const std::string shm = shmName(name);
+    int fd = shm_open(shm.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        std::cerr << "No live export named '" << shm << "'" << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < kLivePage) {
+        std::cerr << "Live export '" << shm << "' is not ready" << std::endl;
+        ::close(fd);
+        return false;
+    }
+    size = (size_t)st.st_size;
+    p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "Failed to map live export '" << shm << "'" << std::endl;
+        return false;
+    }
+#endif
+    header = static_cast<const LiveHeader*>(p);
+    bytes = size;
+
+    const bool ok = std::memcmp(header->magic, kLiveMagic, sizeof(header->magic)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!ok || header->version != kLiveVersion || header->slots < 2 ||
+        header->slotBytes < slotStride((size_t)header->capacity) ||
+        kLivePage + (uint64_t)header->slots * header->slotBytes > size) {
+        std::cerr << "Not a live particle export: " << name << std::endl;
+        detach();
+        return false;
+    }
+    return true;
+}
+
+void LiveReader::detach() {
+    if (!header) return;
+#ifdef _WIN32
+    UnmapViewOfFile(header);
+    if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+    mappingHandle = nullptr;
+#else
+    munmap(const_cast<LiveHeader*>(header), bytes);
+#endif
+    header = nullptr;
+    bytes = 0;
+}
+
+bool LiveReader::acquire(LiveFrame& out) const {
+    if (!header) return false;
+    // A retry only happens when the writer lapped us inside this call; a few are plenty
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        const uint64_t published = header->published.load(std::memory_order_acquire);
+        if (published == 0) return false;
+        const unsigned char* base = slotAt(header, published - 1);
+        const LiveSlot* slot = reinterpret_cast<const LiveSlot*>(base);
+        const uint64_t seq = slot->seq.load(std::memory_order_acquire);
+        if (seq & 1) continue;
+
+        LiveFrame f;
+        f.frame = slot->frame;
+        f.time = slot->time;
+        f.step = slot->step;
+        f.count = (size_t)std::min<uint64_t>(slot->count, header->capacity);
+        f.pos = reinterpret_cast<const float*>(base + posOffset());
+        f.vel = reinterpret_cast<const float*>(base + velOffset((size_t)header->capacity));
+        f.mass = reinterpret_cast<const float*>(base + massOffset((size_t)header->capacity));
+        f.seq = seq;
+        f.slot = slot;
+        if (!valid(f)) continue;
+        out = f;
+        return true;
+    }
+    return false;
+}
+
+bool LiveReader::valid(const LiveFrame& f) const {
+    if (!f.slot) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return f.slot->seq.load(std::memory_order_relaxed) == f.seq;
+}
+
+bool LiveReader::copyLatest(std::vector<Particle>& pts, LiveFrame* info) const {
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        LiveFrame f;
+        if (!acquire(f)) return false;
+        pts.resize(f.count);
+        for (size_t i = 0; i < f.count; ++i) {
+            pts[i].pos = glm::vec3(f.pos[3 * i], f.pos[3 * i + 1], f.pos[3 * i + 2]);
+            pts[i].vel = glm::vec3(f.vel[3 * i], f.vel[3 * i + 1], f.vel[3 * i + 2]);
+            pts[i].mass = f.mass[i];
+        }
+        if (!valid(f)) continue; // overwritten while copying
+        if (info) *info = f;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "particle.h"
+
+// Live export of the particle state through a named shared-memory ring, for
+// analysis or viewer processes running next to the simulation:
+//
+//   LiveHeader              one page
+//   slot 0, slot 1, ...     each: LiveSlot, then float3 pos[capacity],
+//                           float3 vel[capacity], float mass[capacity]
+//
+// The simulation writes frame f into slot f % slots and never waits for
+// anyone. Each slot carries a sequence number (a seqlock): odd while the slot
+// is being written, bumped to the next even value when it is complete. A
+// reader samples the sequence, uses the slot's columns in place, and checks
+// the sequence again; if it changed the data may be torn and the reader
+// simply tries the newest frame again. With N slots a reader has N - 1
+// frames of time before the slot it is looking at is reused.
+
+static constexpr char kLiveMagic[8] = {'N', 'B', 'L', 'I', 'V', 'E', '\0', '\0'};
+static constexpr uint32_t kLiveVersion = 1;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory seqlock needs lock-free 64-bit atomics");
+
+struct LiveHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t slots;
+    uint64_t capacity;               // particles per slot
+    uint64_t slotBytes;              // stride between slots (page multiple)
+    std::atomic<uint64_t> published; // frames published so far; newest is published - 1
+    std::atomic<uint32_t> closed;    // set when the simulation exits
+    uint32_t reserved;
+};
+
+struct LiveSlot {
+    std::atomic<uint64_t> seq; // odd while being written
+    uint64_t frame;
+    double   time;
+    uint64_t step;
+    uint64_t count;            // particles in this frame (<= capacity)
+    uint64_t reserved[3];
+};
+
+// A frame seen in place in the reader's mapping; valid until the slot is reused
+struct LiveFrame {
+    uint64_t frame = 0;
+    double time = 0.0;
+    uint64_t step = 0;
+    size_t count = 0;
+    const float* pos = nullptr;  // count x float3
+    const float* vel = nullptr;  // count x float3
+    const float* mass = nullptr; // count
+    uint64_t seq = 0;            // slot sequence when acquired
+    const LiveSlot* slot = nullptr;
+};
+
+// Simulation side: creates the segment and publishes frames into it
+class LiveExporter {
+public:
+    LiveExporter() = default;
+    ~LiveExporter() { close(); }
+    LiveExporter(const LiveExporter&) = delete;
+    LiveExporter& operator=(const LiveExporter&) = delete;
+
+    // Create (or replace) segment `name` for up to `capacity` particles
+    bool create(const std::string& name, size_t capacity, size_t slots = 3);
+    void publish(const Particle* pts, size_t count, double time, uint64_t step);
+    void close(); // marks the ring closed and removes the name
+
+    bool isOpen() const { return header != nullptr; }
+
+private:
+    LiveHeader* header = nullptr;
+    size_t bytes = 0;
+    std::string segment;
+#ifdef _WIN32
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// Consumer side: attaches read-only and never blocks the simulation
+class LiveReader {
+public:
+    LiveReader() = default;
+    ~LiveReader() { detach(); }
+    LiveReader(const LiveReader&) = delete;
+    LiveReader& operator=(const LiveReader&) = delete;
+
+    bool attach(const std::string& name); // prints the reason and returns false on failure
+    void detach();
+
+    // Newest complete frame, in place; false if none yet (or it kept being overwritten)
+    bool acquire(LiveFrame& frame) const;
+    // True if nothing has overwritten the frame since acquire(): check after using it
+    bool valid(const LiveFrame& frame) const;
+    // Newest frame copied out (positions, velocities, masses; colors are left as they were)
+    bool copyLatest(std::vector<Particle>& pts, LiveFrame* info = nullptr) const;
+
+    uint64_t published() const { return header ? header->published.load(std::memory_order_acquire) : 0; }
+    bool closed() const { return header && header->closed.load(std::memory_order_acquire) != 0; }
+
+private:
+    const LiveHeader* header = nullptr;
+    size_t bytes = 0;
+#ifdef _WIN32
+    void* mappingHandle = nullptr;
+#endif
+};
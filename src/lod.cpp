@@ -0,0 +1,117 @@
+#include "lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "parallel.h"
+
+static constexpr float kMinWeight = 1e-30f; // massless tracers still count (equally) in a tile
+static constexpr size_t kMinLodPerThread = 65536;
+static constexpr float kSplatTiles = 3.0f; // splats overlap their neighbours (see lod.frag)
+
+static uint32_t toRGBA8(const glm::vec3& color) {
+    const glm::vec3 c = glm::clamp(color, glm::vec3(0.0f), glm::vec3(1.0f)) * 255.0f + glm::vec3(0.5f);
+    return (uint32_t)c.x | ((uint32_t)c.y << 8) | ((uint32_t)c.z << 16) | 0xff000000u;
+}
+
+void LodBuilder::Table::clear() {
+    if (slots.empty()) slots.resize(1024);
+    if (used > 0) std::fill(slots.begin(), slots.end(), Tile{});
+    used = 0;
+    nearby.clear();
+}
+
+LodBuilder::Tile& LodBuilder::Table::find(uint64_t key) {
+    if (2 * (used + 1) > slots.size()) grow();
+    const size_t mask = slots.size() - 1;
+    size_t i = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    while (slots[i].key != key) {
+        if (slots[i].key == 0) {
+            slots[i].key = key;
+            ++used;
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return slots[i];
+}
+
+void LodBuilder::Table::grow() {
+    std::vector<Tile> old = std::move(slots);
+    slots.assign(old.size() * 2, Tile{});
+    used = 0;
+    for (const Tile& t : old) {
+        if (t.key == 0) continue;
+        Tile& d = find(t.key);
+        d.mass = t.mass;
+        d.light = t.light;
+        d.massPos = t.massPos;
+        d.massColor = t.massColor;
+    }
+}
+
+void LodBuilder::build(const Particle* pts, size_t n, const glm::vec3& camPos, const glm::mat4& mvp, int viewportW,
+                       int viewportH, const LodParams& params, std::vector<LodVertex>& out) {
+    const float tilePx = std::max(params.splatPixels, 1.0f);
+    const int64_t tilesX = (int64_t)std::ceil((float)std::max(viewportW, 1) / tilePx);
+    const int64_t tilesY = (int64_t)std::ceil((float)std::max(viewportH, 1) / tilePx);
+    const float halfW = 0.5f * (float)viewportW / tilePx, halfH = 0.5f * (float)viewportH / tilePx;
+
+    // Each thread sorts its slice into kept particles and tiles of its own table
+    const size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    const size_t nSlices = std::max<size_t>(1, std::min(threads, n / kMinLodPerThread));
+    slices.resize(nSlices);
+    const size_t per = (n + nSlices - 1) / nSlices;
+    parallelFor(nSlices, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            Table& t = slices[s];
+            t.clear();
+            for (size_t i = s * per; i < std::min(n, (s + 1) * per); ++i) {
+                const Particle& p = pts[i];
+                const float dist = glm::length(p.pos - camPos);
+                if (dist < params.nearDistance) {
+                    t.nearby.push_back(LodVertex{p.pos, toRGBA8(p.color), 0.0f, 0.0f});
+                    continue;
+                }
+                // Tile under the particle; behind the camera or off screen it is not drawn at all
+                const glm::vec4 clip = mvp * glm::vec4(p.pos, 1.0f);
+                if (clip.w <= 0.0f) continue;
+                const float tx = (clip.x / clip.w + 1.0f) * halfW;
+                const float ty = (clip.y / clip.w + 1.0f) * halfH;
+                // Range-check as floats: w near 0 sends tx/ty to +-inf, which cannot be converted to an integer
+                if (!(tx >= 0.0f && ty >= 0.0f && tx < (float)tilesX && ty < (float)tilesY)) continue; // also drops NaN
+                const int64_t ix = std::min((int64_t)tx, tilesX - 1), iy = std::min((int64_t)ty, tilesY - 1);
+
+                const float size = glm::clamp(params.pointSize / (0.06f * dist + 1.0f), 1.0f, 12.0f);
+                Tile& c = t.find((uint64_t)(iy * tilesX + ix) + 1);
+                const float w = std::max(p.mass, kMinWeight);
+                c.mass += w;
+                c.light += size * size;
+                c.massPos += w * p.pos;
+                c.massColor += w * p.color;
+            }
+        }
+    });
+
+    // Merge the slices (at most one tile per splatPixels square of the viewport)
+    out.clear();
+    merged.clear();
+    for (Table& t : slices) {
+        out.insert(out.end(), t.nearby.begin(), t.nearby.end());
+        for (const Tile& c : t.slots) {
+            if (c.key == 0) continue;
+            Tile& d = merged.find(c.key);
+            d.mass += c.mass;
+            d.light += c.light;
+            d.massPos += c.massPos;
+            d.massColor += c.massColor;
+        }
+    }
+    nearPoints = out.size();
+    for (const Tile& c : merged.slots) {
+        if (c.key == 0) continue;
+        out.push_back(LodVertex{c.massPos / c.mass, toRGBA8(c.massColor / c.mass), kSplatTiles * tilePx, c.light});
+    }
+    tiles = out.size() - nearPoints;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "particle.h"
+
+// Level-of-detail point rendering: particles near the camera are drawn one by
+// one, farther ones are merged into one splat per tile of a screen-aligned
+// grid (splatPixels square), so the number of points drawn is bounded by the
+// viewport area instead of N. Particles outside the view are dropped.
+//
+// A tile's splat sits at the mass-weighted centroid of its particles, with
+// their mass-weighted mean color. It carries the summed sprite area the
+// particles would have covered (their size from the attenuation in
+// particle.vert, squared), which lod.vert spreads over a splat three tiles
+// wide, so neighbouring splats blend smoothly and the total light reaching the
+// additive framebuffer is unchanged.
+struct LodParams {
+    float nearDistance = 10.0f; // closer than this to the camera: drawn individually
+    float splatPixels = 4.0f;   // tile edge in pixels
+    float pointSize = 6.0f;     // uPointSize of particle.vert
+};
+
+// One drawn point: a single particle (size == 0) or a tile
+struct LodVertex {
+    glm::vec3 pos;  // particle position, or the tile's mass-weighted centroid
+    uint32_t color; // RGBA8; mass-weighted mean over a tile
+    float size;     // splat size in pixels (0: a single particle, sized as in particle.vert)
+    float light;    // summed sprite area in pixels^2 of the particles it stands for
+};
+static_assert(sizeof(LodVertex) == 24, "LOD vertex layout");
+
+// Builds the LOD point set each frame. Tiles are accumulated in per-thread
+// open-addressed hash tables (kept between frames, so steady-state frames do
+// not allocate) and merged on the calling thread.
+class LodBuilder {
+public:
+    // Replace out with this frame's points: near particles first, then tiles
+    void build(const Particle* pts, size_t n, const glm::vec3& camPos, const glm::mat4& mvp, int viewportW,
+               int viewportH, const LodParams& params, std::vector<LodVertex>& out);
+
+    size_t nearCount() const { return nearPoints; }
+    size_t tileCount() const { return tiles; }
+
+private:
+    struct Tile {
+        uint64_t key;        // tile index + 1; 0: empty slot
+        float mass;          // sum of weights
+        float light;         // sum of sprite areas
+        glm::vec3 massPos;   // sum of weight * position
+        glm::vec3 massColor; // sum of weight * color
+    };
+    struct Table {
+        std::vector<Tile> slots; // power-of-two size, at most half full
+        size_t used = 0;
+        std::vector<LodVertex> nearby;
+        void clear();
+        Tile& find(uint64_t key);
+        void grow();
+    };
+    std::vector<Table> slices; // one per thread
+    Table merged;
+    size_t nearPoints = 0;
+    size_t tiles = 0;
+};
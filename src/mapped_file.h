@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file (mmap on POSIX, file mapping
+// objects on Windows). Pages are faulted in on first touch, so "loading" a
+// large file costs nothing until the data is actually used.
+struct MappedFile {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& o) noexcept { *this = static_cast<MappedFile&&>(o); }
+    MappedFile& operator=(MappedFile&& o) noexcept;
+
+    bool open(const char* path); // prints the reason and returns false on failure
+    void close();
+
+private:
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,217 @@
+#include "out_of_core.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+#include "initial_conditions.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static constexpr uintptr_t kPage = 4096;
+
+// Page-aligned byte range covering particles [first, first + n)
+static void pageRange(Particle* base, size_t first, size_t n, char*& begin, size_t& bytes) {
+    uintptr_t b = reinterpret_cast<uintptr_t>(base + first) & ~(kPage - 1);
+    uintptr_t e = (reinterpret_cast<uintptr_t>(base + first + n) + kPage - 1) & ~(kPage - 1);
+    begin = reinterpret_cast<char*>(b);
+    bytes = (size_t)(e - b);
+}
+
+#ifdef _WIN32
+
+bool ParticleStore::create(const char* path, size_t n) {
+    close();
+    const unsigned long long bytes = (unsigned long long)std::max<size_t>(n, 1) * sizeof(Particle);
+    HANDLE f = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to create particle store: " << path << std::endl;
+        return false;
+    }
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READWRITE, (DWORD)(bytes >> 32), (DWORD)bytes, nullptr);
+    void* p = m ? MapViewOfFile(m, FILE_MAP_ALL_ACCESS, 0, 0, 0) : nullptr;
+    if (!p) {
+        std::cerr << "Failed to map particle store: " << path << std::endl;
+        if (m) CloseHandle(m);
+        CloseHandle(f);
+        return false;
+    }
+    fileHandle = f;
+    mappingHandle = m;
+    pts = static_cast<Particle*>(p);
+    count = n;
+    return true;
+}
+
+void ParticleStore::close() {
+    if (pts) {
+        FlushViewOfFile(pts, 0);
+        UnmapViewOfFile(pts);
+    }
+    if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+    if (fileHandle) CloseHandle((HANDLE)fileHandle);
+    pts = nullptr;
+    count = 0;
+    mappingHandle = fileHandle = nullptr;
+}
+
+void ParticleStore::prefetch(size_t first, size_t n) {
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+    char* b;
+    size_t bytes;
+    pageRange(pts, first, n, b, bytes);
+    WIN32_MEMORY_RANGE_ENTRY range = {b, bytes};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    (void)first;
+    (void)n;
+#endif
+}
+
+void ParticleStore::release(size_t first, size_t n) {
+    char* b;
+    size_t bytes;
+    pageRange(pts, first, n, b, bytes);
+    FlushViewOfFile(b, bytes);
+    VirtualUnlock(b, bytes); // not locked: fails, but trims the pages from the working set
+}
+
+#else
+
+bool ParticleStore::create(const char* path, size_t n) {
+    close();
+    const size_t bytes = std::max<size_t>(n, 1) * sizeof(Particle);
+    int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)bytes) != 0) {
+        std::cerr << "Failed to create particle store: " << path << std::endl;
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the file open
+    if (p == MAP_FAILED) {
+        std::cerr << "Failed to map particle store: " << path << std::endl;
+        return false;
+    }
+    pts = static_cast<Particle*>(p);
+    count = n;
+    return true;
+}
+
+void ParticleStore::close() {
+    if (pts) munmap(pts, std::max<size_t>(count, 1) * sizeof(Particle));
+    pts = nullptr;
+    count = 0;
+}
+
+void ParticleStore::prefetch(size_t first, size_t n) {
+    char* b;
+    size_t bytes;
+    pageRange(pts, first, n, b, bytes);
+    madvise(b, bytes, MADV_WILLNEED);
+}
+
+void ParticleStore::release(size_t first, size_t n) {
+    // Shared file pages survive MADV_DONTNEED: dirty ones are written back
+    // from the page cache, which is free to evict them afterwards
+    char* b;
+    size_t bytes;
+    pageRange(pts, first, n, b, bytes);
+    msync(b, bytes, MS_ASYNC);
+    madvise(b, bytes, MADV_DONTNEED);
+}
+
+#endif
+
+// Spread the low 10 bits of x so there are two zero bits between each
+static uint32_t part1by2(uint32_t x) {
+    x &= 0x3ff;
+    x = (x | x << 16) & 0x030000ff;
+    x = (x | x << 8) & 0x0300f00f;
+    x = (x | x << 4) & 0x030c30c3;
+    x = (x | x << 2) & 0x09249249;
+    return x;
+}
+
+// Reorder a tile along a Morton curve over its own bounding box
+static void mortonSortTile(Particle* p, size_t n, std::vector<std::pair<uint32_t, uint32_t>>& keys,
+                           std::vector<Particle>& scratch) {
+    glm::vec3 lo = p[0].pos, hi = p[0].pos;
+    for (size_t i = 1; i < n; ++i) {
+        lo = glm::min(lo, p[i].pos);
+        hi = glm::max(hi, p[i].pos);
+    }
+    const glm::vec3 scale = 1023.0f / glm::max(hi - lo, glm::vec3(1e-20f));
+    keys.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        glm::vec3 q = (p[i].pos - lo) * scale;
+        keys[i] = {part1by2((uint32_t)q.x) | part1by2((uint32_t)q.y) << 1 | part1by2((uint32_t)q.z) << 2, (uint32_t)i};
+    }
+    std::sort(keys.begin(), keys.end());
+    scratch.resize(n);
+    for (size_t i = 0; i < n; ++i) scratch[i] = p[keys[i].second];
+    std::copy(scratch.begin(), scratch.end(), p);
+}
+
+// Copy the preview samples that fall inside tracers [first, first + n)
+static void refreshPreview(const OutOfCoreTracers& s, size_t first, size_t n, Particle* preview, size_t previewCount) {
+    const size_t stride = s.previewStride;
+    for (size_t j = (first + stride - 1) / stride; j < previewCount && j * stride < first + n; ++j)
+        preview[j] = s.store.data()[j * stride];
+}
+
+bool oocInit(OutOfCoreTracers& s, const char* path, size_t nMassive, size_t nTracers, uint64_t seed,
+             const TracerParams& tracerParams, const OutOfCoreParams& params, std::vector<Particle>& view) {
+    s.params = params;
+    s.params.tileParticles = std::max<size_t>(params.tileParticles, 1024);
+    s.nMassive = nMassive;
+    if (!s.store.create(path, nTracers)) return false;
+
+    const size_t previewCount = std::min(params.previewCount, nTracers);
+    s.previewStride = previewCount ? std::max<size_t>(1, nTracers / previewCount) : 1;
+    view.resize(nMassive + previewCount);
+    makeDiskGalaxyRange(0, nMassive, seed, view.data());
+    for (size_t i = 0; i < nMassive; ++i) view[i].color = glm::vec3(1.0f); // sources drawn white
+    tracerInit(s.sources, view, nMassive, tracerParams);
+
+    // Tracers are disk particles [nMassive, nMassive + nTracers), generated a tile at a time
+    std::vector<std::pair<uint32_t, uint32_t>> keys;
+    std::vector<Particle> scratch;
+    const size_t tile = s.params.tileParticles;
+    for (size_t b = 0; b < nTracers; b += tile) {
+        const size_t n = std::min(tile, nTracers - b);
+        Particle* p = s.store.data() + b;
+        makeDiskGalaxyRange(nMassive + b, n, seed, p);
+        mortonSortTile(p, n, keys, scratch);
+        refreshPreview(s, b, n, view.data() + nMassive, previewCount);
+        s.store.release(b, n);
+    }
+    std::cout << "Out-of-core store: " << nTracers << " tracers in "
+              << (nTracers + tile - 1) / tile << " tiles at " << path << std::endl;
+    return true;
+}
+
+void oocStep(OutOfCoreTracers& s, std::vector<Particle>& view, double dt) {
+    const size_t nTracers = s.store.size();
+    const size_t tile = s.params.tileParticles;
+    const size_t previewCount = view.size() - s.nMassive;
+
+    tracerBeginStep(s.sources, dt);
+    if (nTracers > 0) s.store.prefetch(0, std::min(tile, nTracers));
+    for (size_t b = 0; b < nTracers; b += tile) {
+        const size_t n = std::min(tile, nTracers - b);
+        if (b + n < nTracers) s.store.prefetch(b + n, std::min(tile, nTracers - b - n)); // read ahead
+        tracerStepSpan(s.sources, s.store.data() + b, n, dt);
+        refreshPreview(s, b, n, view.data() + s.nMassive, previewCount);
+        s.store.release(b, n);
+    }
+    tracerEndStep(s.sources, view.data(), dt);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "particle.h"
+#include "tracers.h"
+
+// Out-of-core test-particle runs: the tracers live in a file-backed shared
+// mapping instead of the heap, so N is bounded by disk rather than RAM.
+//
+// The store is processed in tiles of tileParticles. While one tile is being
+// integrated the next is requested with madvise(WILLNEED), so the kernel
+// reads ahead in parallel with the arithmetic; a finished tile is written
+// back asynchronously and dropped from the resident set. Memory use stays at
+// a few tiles no matter how large the store is, and once the store exceeds
+// the page cache a step runs at disk bandwidth instead of thrashing swap.
+// Each tile is Morton sorted when it is generated, so its particles are
+// spatially compact.
+//
+// The viewer gets the sources plus an evenly strided preview sample of the
+// tracers, refreshed as each tile is stepped.
+
+// File-backed read-write mapping of a particle array
+class ParticleStore {
+public:
+    ParticleStore() = default;
+    ~ParticleStore() { close(); }
+    ParticleStore(const ParticleStore&) = delete;
+    ParticleStore& operator=(const ParticleStore&) = delete;
+
+    bool create(const char* path, size_t count); // new file (sparse until written)
+    void close();
+
+    Particle* data() { return pts; }
+    const Particle* data() const { return pts; }
+    size_t size() const { return count; }
+
+    void prefetch(size_t first, size_t n); // start reading these particles in
+    void release(size_t first, size_t n);  // start writeback and drop them from memory
+
+private:
+    Particle* pts = nullptr;
+    size_t count = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+struct OutOfCoreParams {
+    size_t tileParticles = 1u << 20; // 40 MiB of particles per tile
+    size_t previewCount = 1u << 18;  // tracers shown in the viewer
+};
+
+struct OutOfCoreTracers {
+    OutOfCoreParams params;
+    TracerState sources;
+    ParticleStore store;
+    size_t nMassive = 0;
+    size_t previewStride = 1;
+};
+
+// Generate a disk of nMassive + nTracers particles (the same one makeDiskGalaxy
+// gives for the seed): sources into view[0, nMassive), tracers tile by tile
+// into the store at `path`. view is resized to sources + preview.
+bool oocInit(OutOfCoreTracers& s, const char* path, size_t nMassive, size_t nTracers, uint64_t seed,
+             const TracerParams& tracerParams, const OutOfCoreParams& params, std::vector<Particle>& view);
+
+// One tracer step over every tile, updating the sources and preview in view
+void oocStep(OutOfCoreTracers& s, std::vector<Particle>& view, double dt);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Split [0, n) into one contiguous slice per hardware thread and run
+// fn(begin, end) on each. Slices are fixed by n and the thread count only,
+// and small ranges (below `minPerThread` items per thread) run inline on the
+// calling thread to avoid paying for thread start-up.
+template <typename Fn>
+void parallelFor(size_t n, size_t minPerThread, Fn&& fn) {
+    size_t hw = std::max<size_t>(1, std::thread::hardware_concurrency());
+    size_t workers = std::min(hw, std::max<size_t>(1, n / std::max<size_t>(1, minPerThread)));
+    if (workers <= 1) {
+        fn(size_t(0), n);
+        return;
+    }
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    size_t per = (n + workers - 1) / workers;
+    for (size_t w = 1; w < workers; ++w) {
+        size_t b = std::min(n, w * per);
+        size_t e = std::min(n, b + per);
+        pool.emplace_back([&fn, b, e] { fn(b, e); });
+    }
+    fn(size_t(0), std::min(n, per)); // calling thread takes the first slice
+    for (auto& t : pool) t.join();
+}
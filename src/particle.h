@@ -0,0 +1,13 @@
+#pragma once
+
+#include <glm/glm.hpp>        // Vector / matrix types
+
+// Simple particle structure: position + color + velocity (+ mass)
+// Note: Only position and color are sent as vertex attributes; velocity/mass stay CPU-side but
+// live in the same struct so we can update a single VBO each frame if desired.
+struct Particle {
+    glm::vec3 pos;    // world-space position
+    glm::vec3 color;  // display color (sRGB-ish)
+    glm::vec3 vel;    // world-space velocity (simulation)
+    float      mass;  // mass (can keep uniform for all if desired)
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+// Philox4x32-10 counter-based random number generator (Salmon et al., 2011).
+// Output is a pure function of (key, counter): particle i draws from counter
+// {i, stream, 0, 0}, so its values never depend on how many numbers other
+// particles consumed, on generation order, or on the number of threads.
+struct Philox4 {
+    uint32_t v[4];
+};
+
+static inline void philoxMulHiLo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+    uint64_t p = (uint64_t)a * (uint64_t)b;
+    hi = (uint32_t)(p >> 32);
+    lo = (uint32_t)p;
+}
+
+// Ten rounds of Philox on a 128-bit counter with a 64-bit key (the seed)
+static inline Philox4 philox4x32(uint64_t seed, uint64_t index, uint32_t stream) {
+    uint32_t c0 = (uint32_t)index, c1 = (uint32_t)(index >> 32), c2 = stream, c3 = 0;
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    for (int round = 0; round < 10; ++round) {
+        uint32_t hi0, lo0, hi1, lo1;
+        philoxMulHiLo(0xD2511F53u, c0, hi0, lo0);
+        philoxMulHiLo(0xCD9E8D57u, c2, hi1, lo1);
+        uint32_t n0 = hi1 ^ c1 ^ k0;
+        uint32_t n2 = hi0 ^ c3 ^ k1;
+        c0 = n0; c1 = lo1; c2 = n2; c3 = lo0;
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    return Philox4{{c0, c1, c2, c3}};
+}
+
+// Uniform float in [0, 1) from the top 24 bits (exactly representable)
+static inline float philoxUniform(uint32_t bits) {
+    return (float)(bits >> 8) * (1.0f / 16777216.0f);
+}
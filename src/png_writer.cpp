@@ -0,0 +1,155 @@
+#include "png_writer.h"
+
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+// Deflate bit stream (least significant bit first)
+struct BitWriter {
+    std::vector<uint8_t>& out;
+    uint32_t acc = 0;
+    int bits = 0;
+
+    void put(uint32_t value, int n) {
+        acc |= value << bits;
+        bits += n;
+        while (bits >= 8) {
+            out.push_back((uint8_t)acc);
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    // Huffman codes go most significant bit first
+    void putCode(uint32_t code, int n) {
+        uint32_t r = 0;
+        for (int i = 0; i < n; ++i) r |= ((code >> i) & 1u) << (n - 1 - i);
+        put(r, n);
+    }
+    void flush() {
+        if (bits > 0) out.push_back((uint8_t)acc);
+        acc = 0;
+        bits = 0;
+    }
+};
+
+// Fixed Huffman literal/length code of symbol s (RFC 1951, 3.2.6)
+void putSymbol(BitWriter& w, int s) {
+    if (s < 144) w.putCode(0x30 + s, 8);
+    else if (s < 256) w.putCode(0x190 + (s - 144), 9);
+    else if (s < 280) w.putCode(s - 256, 7);
+    else w.putCode(0xc0 + (s - 280), 8);
+}
+
+const uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// Run of `len` (3..258) copies of the previous byte: length code + distance 1
+void putRun(BitWriter& w, int len) {
+    int c = 28;
+    while (kLengthBase[c] > len) --c;
+    putSymbol(w, 257 + c);
+    if (kLengthExtra[c]) w.put((uint32_t)(len - kLengthBase[c]), kLengthExtra[c]);
+    w.putCode(0, 5); // distance code 0 = distance 1
+}
+
+// CRC-32 lookup table, built during static initialization: writePng runs on the
+// render thread (--render) and the capture encoder thread (--capture) at once
+struct CrcTable {
+    uint32_t v[256];
+    CrcTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            v[i] = c;
+        }
+    }
+};
+const CrcTable kCrcTable;
+
+uint32_t crc32(const uint8_t* p, size_t n, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) crc = kCrcTable.v[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+void putBE32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)(v >> 24));
+    out.push_back((uint8_t)(v >> 16));
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+void putChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t n) {
+    putBE32(out, (uint32_t)n);
+    const size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + n);
+    putBE32(out, crc32(out.data() + start, n + 4));
+}
+
+} // namespace
+
+void encodePng(int width, int height, const uint8_t* rgb, std::vector<uint8_t>& out) {
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    out.assign(signature, signature + 8);
+
+    std::vector<uint8_t> ihdr;
+    putBE32(ihdr, (uint32_t)width);
+    putBE32(ihdr, (uint32_t)height);
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8-bit, truecolor, deflate, no filter, no interlace
+    putChunk(out, "IHDR", ihdr.data(), ihdr.size());
+
+    // Scanlines (filter type 0) as one fixed-Huffman block inside a zlib stream
+    std::vector<uint8_t> z = {0x78, 0x01};
+    BitWriter w{z};
+    w.put(1, 1); // final block
+    w.put(1, 2); // fixed Huffman codes
+    uint32_t s1 = 1, s2 = 0; // Adler-32
+    int prev = -1;
+    const size_t rowBytes = (size_t)width * 3;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = rgb + (size_t)y * rowBytes;
+        for (size_t i = 0; i <= rowBytes;) {
+            const int b = i == 0 ? 0 : row[i - 1]; // filter byte, then the pixels
+            size_t run = 0;
+            if (b == prev) {
+                while (run < 258 && i + run <= rowBytes && (i + run == 0 ? 0 : row[i + run - 1]) == b) ++run;
+            }
+            if (run >= 3) {
+                putRun(w, (int)run);
+            } else {
+                run = 1;
+                putSymbol(w, b);
+            }
+            for (size_t k = 0; k < run; ++k) {
+                s1 = (s1 + (uint32_t)b) % 65521;
+                s2 = (s2 + s1) % 65521;
+            }
+            prev = b;
+            i += run;
+        }
+    }
+    putSymbol(w, 256); // end of block
+    w.flush();
+    putBE32(z, (s2 << 16) | s1);
+    putChunk(out, "IDAT", z.data(), z.size());
+    putChunk(out, "IEND", nullptr, 0);
+}
+
+bool writePng(const char* path, int width, int height, const uint8_t* rgb) {
+    std::vector<uint8_t> png;
+    encodePng(width, height, rgb, png);
+    FILE* f = std::fopen(path, "wb");
+    if (!f) {
+        std::cerr << "Failed to create image: " << path << std::endl;
+        return false;
+    }
+    const bool ok = std::fwrite(png.data(), 1, png.size(), f) == png.size();
+    if (std::fclose(f) != 0 || !ok) {
+        std::cerr << "Failed to write image: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
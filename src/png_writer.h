@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Minimal 8-bit RGB PNG encoder with no dependencies. The image data is
+// deflated with fixed Huffman codes and run-length matches only (like
+// zlib's Z_RLE strategy): cheap to encode, and the black background that
+// fills most frames of a particle run shrinks to almost nothing.
+
+// rgb: height rows of width * 3 bytes, top row first
+void encodePng(int width, int height, const uint8_t* rgb, std::vector<uint8_t>& out);
+bool writePng(const char* path, int width, int height, const uint8_t* rgb);
@@ -0,0 +1,24 @@
+#include "preview.h"
+
+#include <algorithm>
+#include <random>
+
+void PreviewSampler::reset(size_t n, uint64_t seed, size_t minCount) {
+    permutation.resize(n);
+    for (size_t i = 0; i < n; ++i) permutation[i] = (uint32_t)i;
+    std::mt19937_64 rng(seed);
+    std::shuffle(permutation.begin(), permutation.end(), rng);
+    minK = std::min(n, minCount);
+    k = std::max(minK, n / 16);
+    smoothedMs = 0.0;
+}
+
+void PreviewSampler::update(double frameMs, double targetMs) {
+    if (frameMs <= 0.0 || targetMs <= 0.0) return;
+    smoothedMs = smoothedMs > 0.0 ? 0.8 * smoothedMs + 0.2 * frameMs : frameMs;
+    // Dead band against hunting; bounded steps so one slow frame cannot collapse K
+    const double ratio = targetMs / smoothedMs;
+    if (ratio > 0.9 && ratio < 1.1) return;
+    const double next = (double)k * std::clamp(ratio, 0.75, 1.25);
+    k = std::clamp((size_t)next, minK, permutation.size());
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Interactive preview of very large particle sets: only a random subset is
+// drawn. The subset is the first K entries of a fixed random permutation, so
+// it is stable from frame to frame (no shimmer) and growing or shrinking K
+// only adds or drops particles at its end. K follows a target render time:
+// each frame's measured cost scales it up or down, on the assumption that
+// cost is proportional to the particles drawn.
+//
+// A drawn particle stands for N / K of them; particle.vert widens its sprite
+// (and brightens it where the size limit is hit) by that factor so the
+// total light, and so the surface brightness of every region, is preserved.
+class PreviewSampler {
+public:
+    // New permutation of n particles; K starts at the larger of minCount and n / 16
+    void reset(size_t n, uint64_t seed, size_t minCount = 10000);
+
+    // Adapt K to this frame's render time (ms) against the target
+    void update(double frameMs, double targetMs);
+
+    const std::vector<uint32_t>& order() const { return permutation; } // draw slot -> particle index
+    size_t size() const { return permutation.size(); }
+    size_t count() const { return k; }
+    float scale() const { return k > 0 ? (float)permutation.size() / (float)k : 1.0f; } // N / K
+
+private:
+    std::vector<uint32_t> permutation;
+    size_t k = 0;
+    size_t minK = 0;
+    double smoothedMs = 0.0;
+};
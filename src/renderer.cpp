@@ -0,0 +1,279 @@
+#include "renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+
+// Below this many particles per thread, pack on the calling thread
+static constexpr size_t kMinPackPerThread = 65536;
+
+static bool hasBufferStorage() { return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage; }
+
+bool StreamingBuffer::create(size_t stride, size_t capacity, UploadPath path) {
+    destroy();
+    vertexBytes = stride;
+    cap = capacity > 0 ? capacity : 1;
+    requested = path;
+    persistentMap = path != UploadPath::Orphan && hasBufferStorage();
+    if (path == UploadPath::Persistent && !persistentMap)
+        std::cerr << "No buffer storage in this GL context; streaming vertices by orphaning" << std::endl;
+
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (persistentMap) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr bytes = (GLsizeiptr)(kRegions * cap * vertexBytes);
+        glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags));
+        if (!mapped) {
+            std::cerr << "Persistent vertex buffer mapping failed; streaming vertices by orphaning" << std::endl;
+            glDeleteBuffers(1, &vbo);
+            glGenBuffers(1, &vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            persistentMap = false;
+        }
+    }
+    if (!persistentMap)
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(cap * vertexBytes), nullptr, GL_STREAM_DRAW);
+    region = 0;
+    firstVertex = 0;
+    return true;
+}
+
+void StreamingBuffer::destroy() {
+    for (GLsync& f : fences) {
+        if (f) glDeleteSync(f);
+        f = nullptr;
+    }
+    if (vbo) {
+        if (mapped) {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        glDeleteBuffers(1, &vbo);
+    }
+    vbo = 0;
+    mapped = nullptr;
+    cap = 0;
+}
+
+bool StreamingBuffer::reserve(size_t count) {
+    if (count <= cap) return false;
+    // The GPU may still read the old ring; deleting it is deferred by the driver
+    create(vertexBytes, count + count / 4, requested);
+    return true;
+}
+
+void* StreamingBuffer::begin(size_t count) {
+    reserve(count);
+    if (persistentMap) {
+        // Region last used kRegions frames ago: usually long finished
+        if (GLsync f = fences[region]) {
+            GLenum r = glClientWaitSync(f, 0, 0);
+            while (r == GL_TIMEOUT_EXPIRED) r = glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            glDeleteSync(f);
+            fences[region] = nullptr;
+        }
+        firstVertex = (size_t)region * cap;
+        return mapped + firstVertex * vertexBytes;
+    }
+    // Detach the storage the GPU may still be reading and write into fresh storage
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(cap * vertexBytes), nullptr, GL_STREAM_DRAW);
+    firstVertex = 0;
+    return glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(count * vertexBytes),
+                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void StreamingBuffer::end() {
+    if (persistentMap) return; // coherent: writes are visible to the next draw
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
+void StreamingBuffer::fence() {
+    if (!persistentMap) return;
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region = (region + 1) % kRegions;
+}
+
+bool HdrTarget::resize(int width, int height) {
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if (fbo && width == w && height == h) return true;
+    destroy();
+    w = width;
+    h = height;
+    glGenTextures(1, &color);
+    glBindTexture(GL_TEXTURE_2D, color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, w, h, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        std::cerr << "RGBA16F framebuffer incomplete; drawing straight to the window" << std::endl;
+        destroy();
+        return false;
+    }
+    glGenVertexArrays(1, &emptyVao);
+    return true;
+}
+
+void HdrTarget::destroy() {
+    if (fbo) glDeleteFramebuffers(1, &fbo);
+    if (color) glDeleteTextures(1, &color);
+    if (emptyVao) glDeleteVertexArrays(1, &emptyVao);
+    fbo = color = emptyVao = 0;
+    w = h = 0;
+}
+
+void HdrTarget::bind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, w, h);
+}
+
+void HdrTarget::resolve() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, w, h);
+    glDisable(GL_BLEND); // every pixel is written once
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, color);
+    glBindVertexArray(emptyVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_BLEND);
+}
+
+void GpuTimer::create() {
+    destroy();
+    glGenQueries(kQueries, queries);
+}
+
+void GpuTimer::destroy() {
+    if (queries[0]) glDeleteQueries(kQueries, queries);
+    for (GLuint& q : queries) q = 0;
+    started = finished = 0;
+    ms = 0.0;
+}
+
+void GpuTimer::begin() {
+    // Collect finished queries first, so a slot is free to reuse
+    for (; finished < started; ++finished) {
+        const GLuint q = queries[finished % kQueries];
+        GLint available = 0;
+        glGetQueryObjectiv(q, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && started - finished < kQueries) break; // else the ring is full: wait for the oldest
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(q, GL_QUERY_RESULT, &ns);
+        ms = 1e-6 * (double)ns;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, queries[started % kQueries]);
+}
+
+void GpuTimer::end() {
+    glEndQuery(GL_TIME_ELAPSED);
+    ++started;
+}
+
+// Bounds pass, then quantize pass, over slots 0..n-1; slot i holds particle index(i)
+template <typename Index>
+static PackBox packSlots(const Particle* pts, size_t n, Index index, PackedVertex* out) {
+    // Per-slice bounds, merged on this thread
+    const size_t slices = std::max<size_t>(1, std::thread::hardware_concurrency());
+    std::vector<glm::vec3> lo(slices, glm::vec3(INFINITY)), hi(slices, glm::vec3(-INFINITY));
+    const size_t per = (n + slices - 1) / slices;
+    parallelFor(slices, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            for (size_t i = s * per; i < std::min(n, (s + 1) * per); ++i) {
+                lo[s] = glm::min(lo[s], pts[index(i)].pos);
+                hi[s] = glm::max(hi[s], pts[index(i)].pos);
+            }
+        }
+    });
+    PackBox box{glm::vec3(0.0f), glm::vec3(1.0f)};
+    if (n == 0) return box;
+    glm::vec3 l = lo[0], h = hi[0];
+    for (size_t s = 1; s < slices; ++s) {
+        l = glm::min(l, lo[s]);
+        h = glm::max(h, hi[s]);
+    }
+    box.origin = l;
+    box.extent = glm::max(h - l, glm::vec3(1e-6f));
+
+    const glm::vec3 toQ = glm::vec3(65535.0f) / box.extent;
+    parallelFor(n, kMinPackPerThread, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec3 q = (pts[index(i)].pos - box.origin) * toQ + glm::vec3(0.5f);
+            out[i].x = (uint16_t)std::min(q.x, 65535.0f);
+            out[i].y = (uint16_t)std::min(q.y, 65535.0f);
+            out[i].z = (uint16_t)std::min(q.z, 65535.0f);
+            out[i].pad = 0;
+        }
+    });
+    return box;
+}
+
+PackBox packPositions(const Particle* pts, size_t n, PackedVertex* out) {
+    return packSlots(pts, n, [](size_t i) { return i; }, out);
+}
+
+PackBox packPositions(const Particle* pts, const uint32_t* order, size_t n, PackedVertex* out) {
+    return packSlots(pts, n, [order](size_t i) { return (size_t)order[i]; }, out);
+}
+
+void packPositions(const Particle* pts, const uint32_t* order, const int32_t* first, const int32_t* count,
+                   size_t ranges, const PackBox& box, PackedVertex* out) {
+    // Visible slots numbered 0..total across the ranges, split evenly over the threads
+    std::vector<size_t> before(ranges + 1, 0);
+    for (size_t r = 0; r < ranges; ++r) before[r + 1] = before[r] + (size_t)count[r];
+    const glm::vec3 toQ = glm::vec3(65535.0f) / box.extent;
+    parallelFor(before[ranges], kMinPackPerThread, [&](size_t begin, size_t end) {
+        size_t r = (size_t)(std::upper_bound(before.begin(), before.end(), begin) - before.begin()) - 1;
+        for (size_t k = begin; k < end; ++r) {
+            const size_t slot0 = (size_t)first[r] + (k - before[r]);
+            const size_t n = std::min(end, before[r + 1]) - k;
+            for (size_t i = slot0; i < slot0 + n; ++i) {
+                const glm::vec3 q = glm::clamp((pts[order[i]].pos - box.origin) * toQ + glm::vec3(0.5f), glm::vec3(0.0f),
+                                               glm::vec3(65535.0f));
+                out[i].x = (uint16_t)q.x;
+                out[i].y = (uint16_t)q.y;
+                out[i].z = (uint16_t)q.z;
+                out[i].pad = 0;
+            }
+            k += n;
+        }
+    });
+}
+
+void packColors(const Particle* pts, const uint32_t* order, size_t n, uint32_t* out) {
+    parallelFor(n, kMinPackPerThread, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec3 c = glm::clamp(pts[order[i]].color, glm::vec3(0.0f), glm::vec3(1.0f)) * 255.0f + glm::vec3(0.5f);
+            out[i] = (uint32_t)c.x | ((uint32_t)c.y << 8) | ((uint32_t)c.z << 16) | 0xff000000u;
+        }
+    });
+}
+
+void packColors(const Particle* pts, size_t n, uint32_t* out) {
+    parallelFor(n, kMinPackPerThread, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec3 c = glm::clamp(pts[i].color, glm::vec3(0.0f), glm::vec3(1.0f)) * 255.0f + glm::vec3(0.5f);
+            out[i] = (uint32_t)c.x | ((uint32_t)c.y << 8) | ((uint32_t)c.z << 16) | 0xff000000u;
+        }
+    });
+}
+
+void packStates(const Particle* pts, size_t n, StateVertex* out) {
+    parallelFor(n, kMinPackPerThread, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) out[i] = StateVertex{pts[i].pos, pts[i].vel};
+    });
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "particle.h"
+
+// How per-frame vertex data reaches the GPU
+enum class UploadPath {
+    Auto,       // persistent if the context has buffer storage, else orphan
+    Persistent, // ARB_buffer_storage: mapped once, written in place, fenced ring
+    Orphan      // glBufferData(NULL) each frame, then an unsynchronized map
+};
+
+// Vertex buffer the CPU refills every frame without stalling on the GPU.
+//
+// Persistent path: one immutable buffer three frames long, mapped for the
+// whole run (persistent + coherent). Frame f is written straight into region
+// f % 3, so the driver makes no copy, and a fence placed after the frame's
+// draws guards the region until the GPU has read it; the CPU only waits if
+// it gets three frames ahead. Point the streamed attributes at offset()
+// each frame; other (static) attributes are unaffected.
+//
+// Orphan path (no buffer storage): each frame detaches the old storage with
+// glBufferData(NULL) and maps fresh storage, which also avoids the implicit
+// sync of glBufferSubData, at the cost of a driver-side allocation.
+class StreamingBuffer {
+public:
+    StreamingBuffer() = default;
+    ~StreamingBuffer() { destroy(); }
+    StreamingBuffer(const StreamingBuffer&) = delete;
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+    // stride = bytes per vertex; capacity = vertices per frame
+    bool create(size_t stride, size_t capacity, UploadPath path = UploadPath::Auto);
+    void destroy();
+
+    // Grow to hold `count` vertices. True if the buffer object was replaced,
+    // in which case vertex attribute pointers must be set up again.
+    bool reserve(size_t count);
+
+    void* begin(size_t count); // writable room for this frame's `count` vertices
+    void end();                // finished writing
+    size_t offset() const { return firstVertex * vertexBytes; } // byte offset of this frame's data
+    void fence();              // after the draws that read this frame
+
+    GLuint buffer() const { return vbo; }
+    bool persistent() const { return persistentMap; }
+    size_t capacity() const { return cap; }
+
+    static constexpr int kRegions = 3;
+
+private:
+    GLuint vbo = 0;
+    size_t vertexBytes = 0;
+    size_t cap = 0;
+    UploadPath requested = UploadPath::Auto;
+    bool persistentMap = false;
+    unsigned char* mapped = nullptr; // persistent path: the whole ring
+    GLsync fences[kRegions] = {};
+    int region = 0;
+    size_t firstVertex = 0;
+};
+
+// Floating-point (RGBA16F) target for the additive particle blend. Dense
+// regions sum far past 1 without clipping; resolve() then draws one
+// fullscreen triangle into the default framebuffer with a tonemap program
+// (shaders/tonemap.frag), so the per-particle fragment shaders stay as they
+// are and the only extra cost is one read of the target per pixel.
+class HdrTarget {
+public:
+    HdrTarget() = default;
+    ~HdrTarget() { destroy(); }
+    HdrTarget(const HdrTarget&) = delete;
+    HdrTarget& operator=(const HdrTarget&) = delete;
+
+    // (Re)allocate for a width x height framebuffer; no-op if the size is unchanged.
+    // False if the driver cannot render to RGBA16F.
+    bool resize(int width, int height);
+    void destroy();
+
+    void bind();    // draw into the target (and set the viewport to it)
+    void resolve(); // tonemap into the default framebuffer; the caller has the program bound
+
+    bool valid() const { return fbo != 0; }
+
+private:
+    GLuint fbo = 0;
+    GLuint color = 0;
+    GLuint emptyVao = 0; // the fullscreen triangle comes from gl_VertexID
+    int w = 0, h = 0;
+};
+
+// GPU time of a span of commands (GL_TIME_ELAPSED). Queries rotate through
+// a small ring and are read back only once available, a few frames later,
+// so measuring never waits for the GPU.
+class GpuTimer {
+public:
+    GpuTimer() = default;
+    ~GpuTimer() { destroy(); }
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void create();
+    void destroy();
+    void begin(); // not nested: one GL_TIME_ELAPSED query may be active at a time
+    void end();
+
+    double lastMs() const { return ms; } // latest completed measurement (0 until the first)
+
+    static constexpr int kQueries = 4;
+
+private:
+    GLuint queries[kQueries] = {};
+    uint64_t started = 0, finished = 0;
+    double ms = 0.0;
+};
+
+// Render-only vertex: position quantized to 16 bits per axis inside the
+// frame's bounding box (read as normalized unsigned shorts and mapped back
+// with the box in particle.vert). 8 bytes instead of the 40 of a Particle.
+struct PackedVertex {
+    uint16_t x, y, z, pad;
+};
+static_assert(sizeof(PackedVertex) == 8, "packed vertex layout");
+
+// Frame bounding box: world position = origin + normalized * extent
+struct PackBox {
+    glm::vec3 origin;
+    glm::vec3 extent;
+};
+
+// One particle at a completed physics step, at full precision. Two of them
+// (the last two steps) are blended per vertex in hermite.vert.
+struct StateVertex {
+    glm::vec3 pos;
+    glm::vec3 vel;
+};
+static_assert(sizeof(StateVertex) == 24, "state vertex layout");
+
+// Quantize positions into out (bounds pass, then quantize pass, both on all cores)
+PackBox packPositions(const Particle* pts, size_t n, PackedVertex* out);
+
+// Colors as RGBA8 (uploaded once; they do not change while stepping)
+void packColors(const Particle* pts, size_t n, uint32_t* out);
+
+// The first n slots of a draw order (slot i holds particle order[i]), with
+// the bounds of just those particles
+PackBox packPositions(const Particle* pts, const uint32_t* order, size_t n, PackedVertex* out);
+
+// Positions and velocities (on all cores)
+void packStates(const Particle* pts, size_t n, StateVertex* out);
+
+// Culled variants: draw slot i holds particle order[i]. Only the slots in the
+// given ranges are written, with a box the caller already knows (the bounds
+// of the visible particles), so nothing outside the ranges is read.
+void packPositions(const Particle* pts, const uint32_t* order, const int32_t* first, const int32_t* count,
+                   size_t ranges, const PackBox& box, PackedVertex* out);
+void packColors(const Particle* pts, const uint32_t* order, size_t n, uint32_t* out);
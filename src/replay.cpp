@@ -0,0 +1,168 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "parallel.h"
+
+// Particles interpolated per inner block; their 3 * kReplayBlock floats stay in L1
+static constexpr size_t kReplayBlock = 1024;
+
+// Below this many particles per thread, interpolate on the calling thread
+static constexpr size_t kMinReplayPerThread = 65536;
+
+std::string seriesKeyframeName(uint64_t step) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "key_%012llu.nbs", (unsigned long long)step);
+    return name;
+}
+
+bool appendSeriesIndex(const std::string& dir, double time, uint64_t step, const std::string& file) {
+    std::ofstream out(std::filesystem::path(dir) / "index.txt", std::ios::app);
+    out.precision(17);
+    out << time << ' ' << step << ' ' << file << '\n';
+    return static_cast<bool>(out.flush());
+}
+
+bool Replay::open(const std::string& dir) {
+    namespace fs = std::filesystem;
+    keys.clear();
+    std::ifstream in(fs::path(dir) / "index.txt");
+    if (!in) {
+        std::cerr << "No series index in " << dir << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ls(line);
+        Keyframe k;
+        std::string file;
+        if (!(ls >> k.time >> k.step >> file)) continue;
+        k.path = (fs::path(dir) / file).string();
+        if (!fs::exists(k.path)) {
+            std::cerr << "Skipping missing keyframe " << k.path << std::endl;
+            continue;
+        }
+        keys.push_back(k);
+    }
+    // Time order; a repeated time keeps the later entry
+    std::stable_sort(keys.begin(), keys.end(), [](const Keyframe& a, const Keyframe& b) { return a.time < b.time; });
+    std::vector<Keyframe> unique;
+    for (const Keyframe& k : keys) {
+        if (!unique.empty() && unique.back().time == k.time) unique.back() = k;
+        else unique.push_back(k);
+    }
+    keys.swap(unique);
+    if (keys.empty()) {
+        std::cerr << "Series has no keyframes: " << dir << std::endl;
+        return false;
+    }
+
+    // Two buckets per keyframe: for evenly spaced keyframes a lookup lands on or next to its answer
+    const size_t nb = 2 * keys.size();
+    bucketWidth = (endTime() - startTime()) / (double)nb;
+    if (!(bucketWidth > 0.0)) bucketWidth = 1.0;
+    buckets.assign(nb, 0);
+    for (size_t j = 0, k = 0; j < nb; ++j) {
+        const double t = startTime() + (double)j * bucketWidth;
+        while (k + 1 < keys.size() && keys[k + 1].time <= t) ++k;
+        buckets[j] = (uint32_t)k;
+    }
+
+    mappedKey[0] = mappedKey[1] = SIZE_MAX;
+    colorKey = SIZE_MAX;
+    const Snapshot* first = mapKeyframe(0);
+    if (!first) return false;
+    particleCount = first->count();
+    std::cout << "Replay: " << keys.size() << " keyframes, " << particleCount << " particles, t = "
+              << startTime() << " .. " << endTime() << std::endl;
+    return true;
+}
+
+size_t Replay::keyframeAt(double t) const {
+    double b = std::floor((t - startTime()) / bucketWidth);
+    size_t j = b <= 0.0 ? 0 : std::min(buckets.size() - 1, (size_t)b);
+    size_t k = buckets[j];
+    while (k + 1 < keys.size() && keys[k + 1].time <= t) ++k;
+    return k;
+}
+
+const Snapshot* Replay::mapKeyframe(size_t k) {
+    for (int s = 0; s < 2; ++s) {
+        if (mappedKey[s] == k) {
+            nextSlot = 1 - s; // keep this one, evict the other next
+            return &mapped[s];
+        }
+    }
+    const size_t s = nextSlot;
+    mappedKey[s] = SIZE_MAX;
+    if (!openSnapshot(keys[k].path.c_str(), mapped[s])) return nullptr;
+    if (particleCount != 0 && mapped[s].count() != particleCount) {
+        std::cerr << "Keyframe " << keys[k].path << " has " << mapped[s].count() << " particles, expected "
+                  << particleCount << std::endl;
+        return nullptr;
+    }
+    mappedKey[s] = k;
+    nextSlot = 1 - s;
+    return &mapped[s];
+}
+
+// out = h00 * p0 + h10 * v0 + h01 * p1 + h11 * v1 over n floats
+static void hermite(const float* p0, const float* v0, const float* p1, const float* v1, size_t n,
+                    float h00, float h10, float h01, float h11, float* out) {
+    for (size_t i = 0; i < n; ++i)
+        out[i] = h00 * p0[i] + h10 * v0[i] + h01 * p1[i] + h11 * v1[i];
+}
+
+bool Replay::sample(double t, std::vector<Particle>& pts) {
+    if (keys.empty()) return false;
+    t = std::clamp(t, startTime(), endTime());
+    const size_t k = keyframeAt(t);
+    const Snapshot* a = mapKeyframe(k);
+    if (!a) return false;
+    const bool between = k + 1 < keys.size() && t > keys[k].time;
+    const Snapshot* b = between ? mapKeyframe(k + 1) : a;
+    if (!b) return false;
+    a = mapKeyframe(k); // still mapped: the k + 1 lookup evicted the other slot
+
+    const size_t n = particleCount;
+    pts.resize(n);
+    if (colorKey != k) {
+        for (size_t i = 0; i < n; ++i) {
+            pts[i].color = a->color ? a->color[i] : glm::vec3(1.0f);
+            pts[i].mass = a->mass ? a->mass[i] : 1.0f;
+        }
+        colorKey = k;
+    }
+
+    // Hermite basis at s in [0, 1]; the velocity terms carry the keyframe spacing
+    const double dt = between ? keys[k + 1].time - keys[k].time : 0.0;
+    const double s = between ? (t - keys[k].time) / dt : 0.0;
+    const double s2 = s * s, s3 = s2 * s;
+    const float h00 = (float)(2.0 * s3 - 3.0 * s2 + 1.0);
+    const float h10 = (float)((s3 - 2.0 * s2 + s) * dt);
+    const float h01 = (float)(-2.0 * s3 + 3.0 * s2);
+    const float h11 = (float)((s3 - s2) * dt);
+
+    const float* p0 = reinterpret_cast<const float*>(a->pos);
+    const float* v0 = reinterpret_cast<const float*>(a->vel);
+    const float* p1 = reinterpret_cast<const float*>(b->pos);
+    const float* v1 = reinterpret_cast<const float*>(b->vel);
+    parallelFor(n, kMinReplayPerThread, [&](size_t begin, size_t end) {
+        float blockPos[3 * kReplayBlock];
+        for (size_t b0 = begin; b0 < end; b0 += kReplayBlock) {
+            const size_t nb = std::min(kReplayBlock, end - b0);
+            hermite(p0 + 3 * b0, v0 + 3 * b0, p1 + 3 * b0, v1 + 3 * b0, 3 * nb, h00, h10, h01, h11, blockPos);
+            for (size_t i = 0; i < nb; ++i) {
+                pts[b0 + i].pos = glm::vec3(blockPos[3 * i], blockPos[3 * i + 1], blockPos[3 * i + 2]);
+                pts[b0 + i].vel = glm::vec3(v0[3 * (b0 + i)], v0[3 * (b0 + i) + 1], v0[3 * (b0 + i) + 2]);
+            }
+        }
+    });
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "particle.h"
+#include "snapshot.h"
+
+// A recorded run ("series") is a directory of .nbs keyframes plus a text
+// index, one "time step file" line per keyframe:
+//
+//   run/index.txt
+//   run/key_000000000100.nbs
+//   ...
+//
+// Keyframes must all hold the same particles in the same order.
+
+std::string seriesKeyframeName(uint64_t step);
+bool appendSeriesIndex(const std::string& dir, double time, uint64_t step, const std::string& file);
+
+// Plays a series back without re-simulating it.
+//
+// Keyframes are memory-mapped on demand (only the two bracketing the current
+// time are kept mapped). Seeking is O(1): times are bucketed on a uniform
+// grid when the index is loaded, and each bucket knows its keyframe. Between
+// keyframes positions follow the cubic Hermite curve through both keyframes'
+// positions and velocities, evaluated over the flat float columns of the
+// mapped files (plain loops the compiler vectorizes) and spread over all cores.
+class Replay {
+public:
+    bool open(const std::string& dir); // false (and prints why) if unusable
+
+    double startTime() const { return keys.empty() ? 0.0 : keys.front().time; }
+    double endTime() const { return keys.empty() ? 0.0 : keys.back().time; }
+    size_t keyframes() const { return keys.size(); }
+    size_t count() const { return particleCount; }
+
+    // State at time t (clamped to the recording) into pts, resized to count()
+    bool sample(double t, std::vector<Particle>& pts);
+
+private:
+    struct Keyframe {
+        double time;
+        uint64_t step;
+        std::string path;
+    };
+
+    size_t keyframeAt(double t) const; // last keyframe with time <= t
+    const Snapshot* mapKeyframe(size_t k);
+
+    std::vector<Keyframe> keys;
+    std::vector<uint32_t> buckets;     // keyframe at the start of each time bucket
+    double bucketWidth = 1.0;
+    size_t particleCount = 0;
+
+    Snapshot mapped[2];
+    size_t mappedKey[2] = {SIZE_MAX, SIZE_MAX};
+    size_t nextSlot = 0;
+    size_t colorKey = SIZE_MAX;        // keyframe whose colors pts currently holds
+};
@@ -8,16 +8,42 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>  // C++17: for current_path()
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
 
-// Simple particle structure: position + color + velocity (+ mass)
-// Note: Only position and color are sent as vertex attributes; velocity/mass stay CPU-side but
-// live in the same struct so we can update a single VBO each frame if desired.
-struct Particle {
-    glm::vec3 pos;    // world-space position
-    glm::vec3 color;  // display color (sRGB-ish)
-    glm::vec3 vel;    // world-space velocity (simulation)
-    float      mass;  // mass (can keep uniform for all if desired)
-};
+#include "particle.h"
+#include "gadget.h"
+#include "culling.h"
+#include "frame_capture.h"
+#include "frame_stream.h"
+#include "initial_conditions.h"
+#include "live_export.h"
+#include "lod.h"
+#include "out_of_core.h"
+#include "png_writer.h"
+#include "preview.h"
+#include "snapshot.h"
+#include "snapshot_codec.h"
+#include "snapshot_writer.h"
+#include "wisdom_holman.h"
+#include "ias15.h"
+#include "renderer.h"
+#include "replay.h"
+#include "shader_cache.h"
+#include "splat_renderer.h"
+#include "tracers.h"
+#include "trajectory.h"
 
 // Read entire text file (shader source)
 static std::string loadTextFile(const char* path) {
@@ -48,28 +74,38 @@ static GLuint compile(GLenum type, const char* src) {
     return sh;
 }
 
-// Link vertex + fragment program
-static GLuint makeProgram(const char* vsPath, const char* fsPath) {
+// Link vertex + fragment program; with a cache directory, reuse the binary of an
+// identical earlier build (same sources and driver) instead of compiling
+static GLuint makeProgram(const char* vsPath, const char* fsPath, const std::string& cacheDir = {}) {
     std::string vs = loadTextFile(vsPath);
     std::string fs = loadTextFile(fsPath);
 
-    // Diagnostics: print byte sizes to confirm loading worked
-    std::cout << "Loaded " << vsPath << ": " << vs.size() << " bytes\n";
-    std::cout << "Loaded " << fsPath << ": " << fs.size() << " bytes\n";
+    // Diagnostics: print byte sizes to confirm loading worked (one write: the
+    // initial conditions may be printing from another thread)
+    std::cout << ("Loaded " + std::string(vsPath) + ": " + std::to_string(vs.size()) + " bytes\nLoaded " +
+                  std::string(fsPath) + ": " + std::to_string(fs.size()) + " bytes\n");
 
     // Fail fast if either is empty; this prevents confusing GL link errors
     if (vs.empty() || fs.empty()) {
         std::cerr << "Shader source empty. Check working directory and shader copy step." << std::endl;
         return 0;
     }
+    GLuint prog = glCreateProgram();
+    const bool cached = !cacheDir.empty() && programBinarySupported();
+    const uint64_t key = cached ? programCacheKey(vs, fs) : 0;
+    if (cached && loadCachedProgram(cacheDir, key, prog)) {
+        std::cout << ("Linked program from " + cacheDir + " (skipped compiling)\n");
+        return prog;
+    }
     GLuint v = compile(GL_VERTEX_SHADER, vs.c_str());
     GLuint f = compile(GL_FRAGMENT_SHADER, fs.c_str());
-    GLuint prog = glCreateProgram();
     glAttachShader(prog, v);
     glAttachShader(prog, f);
+    if (cached) glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(prog);
     GLint ok = 0;
     glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (ok && cached) storeCachedProgram(cacheDir, key, prog);
     if (!ok) {
         GLint len = 0;
         glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &len);
@@ -82,53 +118,6 @@ static GLuint makeProgram(const char* vsPath, const char* fsPath) {
     return prog;
 }
 
-// Create N random particles in a cube; colors in a light range
-// Initialize a simple disk galaxy: particles distributed in a thin disk with
-// tangential (orbital) velocities around the origin. We also color by radius
-// to get a pleasant gradient.
-static std::vector<Particle> makeDiskGalaxy(size_t n) {
-    std::vector<Particle> pts;
-    pts.reserve(n);
-    std::mt19937 rng(std::random_device{}());
-
-    // Radial distribution: more stars toward the center using an exponential profile
-    std::uniform_real_distribution<float> u01(0.f, 1.f);
-    std::normal_distribution<float> zdist(0.f, 0.2f); // thin disk thickness
-
-    const float Rmax = 8.0f; // disk radius
-    const float vScale = 2.0f; // overall velocity scale
-
-    for (size_t i = 0; i < n; ++i) {
-        float u = u01(rng);
-        // Invert an exponential cdf roughly: r ~ -Rmax * ln(1 - u)
-        // Clamp to Rmax
-        float r = glm::min(-Rmax * std::log(1.0f - glm::max(u, 1e-4f)), Rmax);
-        float a = u01(rng) * 2.0f * 3.14159265f; // angle
-        float x = r * std::cos(a);
-        float y = r * std::sin(a);
-        float z = zdist(rng);
-
-        glm::vec3 pos(x, y, z);
-
-        // Tangential unit vector (perpendicular to radial)
-        glm::vec3 radial = glm::normalize(glm::vec3(x, y, 0.0f));
-        glm::vec3 tangential = glm::vec3(-radial.y, radial.x, 0.0f);
-
-        // Rough orbital speed that falls off with radius (softened)
-        float vtheta = vScale / std::sqrt(r + 0.2f);
-        glm::vec3 vel = vtheta * tangential;
-
-        // Color gradient: inner stars bluish/magenta, outer more golden
-        float t = glm::clamp(r / Rmax, 0.0f, 1.0f);
-        glm::vec3 inner(0.8f, 0.6f, 1.0f); // magenta-ish
-        glm::vec3 outer(1.0f, 0.8f, 0.2f); // golden
-        glm::vec3 col = glm::mix(inner, outer, t);
-
-        pts.push_back({pos, col, vel, 1.0f});
-    }
-    return pts;
-}
-
 // Simple central-gravity update with softening to keep things stable.
 static void stepParticles(std::vector<Particle>& pts, float dt) {
     const float mu = 25.0f;      // G * Mcentral
@@ -145,132 +134,1145 @@ static void stepParticles(std::vector<Particle>& pts, float dt) {
     }
 }
 
-int main() {
+// Which update rule advances the particles each frame
+enum class IntegratorKind {
+    Euler,        // stepParticles: softened central force, semi-implicit Euler
+    WisdomHolman, // exact Kepler drift + interaction kick (wisdom_holman.h)
+    IAS15,        // adaptive 15th-order Gauss-Radau (ias15.h)
+    Tracers       // few massive sources + massless tracers (tracers.h)
+};
+static constexpr uint32_t kIntegratorKinds = 4;
+
+// Command-line switches (all optional)
+struct SimOptions {
+    IntegratorKind integrator = IntegratorKind::Euler;
+    size_t massive = 64; // number of massive sources in tracer mode
+    bool hasMassive = false; // false: default, or whatever a restarted run used
+    uint64_t seed = 0;   // initial-condition seed
+    bool hasSeed = false; // false: pick a fresh seed (printed so the run can be repeated)
+    size_t particles = 3000;
+    std::string ic = "disk"; // "disk" (makeDiskGalaxy), a galaxyPreset name, or "gadget:<file>"
+    bool hasIntegrator = false; // false: default, or whatever a restarted run used
+    std::string restart;        // checkpoint to resume from (empty = generate ICs)
+    std::string checkpoint;     // checkpoint to write (empty = never)
+    uint64_t checkpointEvery = 0; // steps between checkpoints (0 = only on exit)
+    bool directIO = false;        // write checkpoints with O_DIRECT where supported
+    IOBackend io = IOBackend::Sync; // checkpoint transfers: pwrite/mmap, or io_uring
+    double compressError = 0.0;     // > 0: lossy .nbz checkpoints with this position error bound
+    double compressVelError = 0.0;  // velocity error bound (0 = same as positions)
+    std::string gadgetOut;          // GADGET snapshot to write on exit (empty = none)
+    int gadgetFormat = 2;           // 1 or 2
+    std::string outOfCore;          // tracer store file: tracers live on disk, not in RAM
+    size_t tileParticles = 1u << 20; // out-of-core tile size
+    std::string record;             // trajectory file for selected particles (empty = off)
+    std::string recordIds;          // selection, e.g. "0-99,5000"; empty = 1024 spread over the run
+    std::string series;             // directory of keyframes for --replay (empty = off)
+    uint64_t seriesEvery = 10;      // steps between keyframes
+    std::string replay;             // series to play back instead of simulating
+    std::string live;               // shared-memory name to publish every frame under (empty = off)
+    size_t liveSlots = 3;           // frames in the live ring
+    std::string stream;             // socket to stream quantized frames on (empty = off)
+    std::string viewStream;         // socket to display a streamed run from instead of simulating
+    UploadPath upload = UploadPath::Auto; // how vertices are streamed to the GPU
+    uint64_t frames = 0;            // exit after this many frames (0 = run until closed)
+    bool colorByRadius = false;     // shade by distance from the origin instead of per-particle colors
+    bool lod = false;               // merge far particles into one splat per screen tile
+    LodParams lodParams;            // --lod=DIST near distance, --lod-pixels=P tile size
+    bool cull = false;              // upload and draw only the octree leaves inside the view
+    size_t cullLeaf = 4096;         // particles per culling leaf
+    uint64_t cullReorder = 120;     // frames between Morton re-sorts of the draw order
+    glm::vec3 camera{0.0f, 0.0f, 18.0f}; // starting camera position (looking at the origin)
+    std::string render;             // directory for software-rendered PNG frames (empty = off)
+    uint64_t renderEvery = 1;       // frames between rendered images
+    int renderWidth = 1280, renderHeight = 720;
+    float exposure = 1.0f;          // tonemap (software and --hdr): 1 - exp(-exposure * light)
+    bool hdr = false;               // blend into an RGBA16F target, then one tonemap pass to the window
+    bool interpolate = false;       // physics on its own thread; draw a blend of its last two steps
+    bool preview = false;           // draw a stable random subset sized to a render-time budget
+    double previewMs = 10.0;        // that budget per frame (pack + upload on the CPU, or the draw on the GPU)
+    bool headless = false;          // no window or GL context at all (nodes without a GPU)
+    double fixedDt = 0.0;           // > 0: fixed step instead of the wall-clock frame time
+    std::string capture;            // record the window: PNG directory or "ffmpeg:FILE" (empty = off)
+    int captureFps = 60;            // frame rate of the ffmpeg video
+    std::string shaderCache = "shaders/cache"; // linked program binaries (empty = always compile)
+};
+
+// Parse "--name=value" style arguments; unknown ones are reported and ignored
+static SimOptions parseOptions(int argc, char** argv) {
+    SimOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--integrator=euler") == 0) {
+            opts.integrator = IntegratorKind::Euler;
+            opts.hasIntegrator = true;
+        } else if (std::strcmp(arg, "--integrator=wh") == 0) {
+            opts.integrator = IntegratorKind::WisdomHolman;
+            opts.hasIntegrator = true;
+        } else if (std::strcmp(arg, "--integrator=ias15") == 0) {
+            opts.integrator = IntegratorKind::IAS15;
+            opts.hasIntegrator = true;
+        } else if (std::strcmp(arg, "--integrator=tracers") == 0) {
+            opts.integrator = IntegratorKind::Tracers;
+            opts.hasIntegrator = true;
+        } else if (std::strncmp(arg, "--massive=", 10) == 0) {
+            opts.massive = std::strtoul(arg + 10, nullptr, 10);
+            opts.hasMassive = true;
+        } else if (std::strncmp(arg, "--seed=", 7) == 0) {
+            opts.seed = std::strtoull(arg + 7, nullptr, 10);
+            opts.hasSeed = true;
+        } else if (std::strncmp(arg, "--particles=", 12) == 0) {
+            opts.particles = std::strtoull(arg + 12, nullptr, 10);
+        } else if (std::strncmp(arg, "--ic=", 5) == 0) {
+            opts.ic = arg + 5;
+        } else if (std::strncmp(arg, "--restart=", 10) == 0) {
+            opts.restart = arg + 10;
+        } else if (std::strncmp(arg, "--checkpoint=", 13) == 0) {
+            opts.checkpoint = arg + 13;
+        } else if (std::strncmp(arg, "--checkpoint-every=", 19) == 0) {
+            opts.checkpointEvery = std::strtoull(arg + 19, nullptr, 10);
+        } else if (std::strcmp(arg, "--direct-io") == 0) {
+            opts.directIO = true;
+        } else if (std::strcmp(arg, "--io=uring") == 0) {
+            opts.io = IOBackend::IoUring;
+        } else if (std::strcmp(arg, "--io=pwrite") == 0) {
+            opts.io = IOBackend::Sync;
+        } else if (std::strncmp(arg, "--compress=", 11) == 0) {
+            opts.compressError = std::strtod(arg + 11, nullptr);
+        } else if (std::strncmp(arg, "--compress-vel=", 15) == 0) {
+            opts.compressVelError = std::strtod(arg + 15, nullptr);
+        } else if (std::strncmp(arg, "--gadget-out=", 13) == 0) {
+            opts.gadgetOut = arg + 13;
+        } else if (std::strncmp(arg, "--out-of-core=", 14) == 0) {
+            opts.outOfCore = arg + 14;
+        } else if (std::strncmp(arg, "--tile=", 7) == 0) {
+            opts.tileParticles = std::strtoull(arg + 7, nullptr, 10);
+        } else if (std::strncmp(arg, "--record=", 9) == 0) {
+            opts.record = arg + 9;
+        } else if (std::strncmp(arg, "--record-ids=", 13) == 0) {
+            opts.recordIds = arg + 13;
+        } else if (std::strncmp(arg, "--series=", 9) == 0) {
+            opts.series = arg + 9;
+        } else if (std::strncmp(arg, "--series-every=", 15) == 0) {
+            opts.seriesEvery = std::strtoull(arg + 15, nullptr, 10);
+        } else if (std::strncmp(arg, "--replay=", 9) == 0) {
+            opts.replay = arg + 9;
+        } else if (std::strncmp(arg, "--live=", 7) == 0) {
+            opts.live = arg + 7;
+        } else if (std::strncmp(arg, "--live-slots=", 13) == 0) {
+            opts.liveSlots = std::strtoul(arg + 13, nullptr, 10);
+        } else if (std::strncmp(arg, "--stream=", 9) == 0) {
+            opts.stream = arg + 9;
+        } else if (std::strncmp(arg, "--view-stream=", 14) == 0) {
+            opts.viewStream = arg + 14;
+        } else if (std::strcmp(arg, "--upload=persistent") == 0) {
+            opts.upload = UploadPath::Persistent;
+        } else if (std::strcmp(arg, "--upload=orphan") == 0) {
+            opts.upload = UploadPath::Orphan;
+        } else if (std::strcmp(arg, "--color=radius") == 0) {
+            opts.colorByRadius = true;
+        } else if (std::strcmp(arg, "--color=static") == 0) {
+            opts.colorByRadius = false;
+        } else if (std::strcmp(arg, "--lod") == 0) {
+            opts.lod = true;
+        } else if (std::strncmp(arg, "--lod=", 6) == 0) {
+            opts.lod = true;
+            opts.lodParams.nearDistance = std::strtof(arg + 6, nullptr);
+        } else if (std::strncmp(arg, "--lod-pixels=", 13) == 0) {
+            opts.lod = true;
+            opts.lodParams.splatPixels = std::strtof(arg + 13, nullptr);
+        } else if (std::strcmp(arg, "--cull") == 0) {
+            opts.cull = true;
+        } else if (std::strncmp(arg, "--cull-leaf=", 12) == 0) {
+            opts.cull = true;
+            opts.cullLeaf = std::max<size_t>(1, std::strtoull(arg + 12, nullptr, 10));
+        } else if (std::strncmp(arg, "--cull-reorder=", 15) == 0) {
+            opts.cull = true;
+            opts.cullReorder = std::max<uint64_t>(1, std::strtoull(arg + 15, nullptr, 10));
+        } else if (std::strncmp(arg, "--camera=", 9) == 0) {
+            float c[3] = {0.0f, 0.0f, 18.0f};
+            std::sscanf(arg + 9, "%f,%f,%f", &c[0], &c[1], &c[2]);
+            opts.camera = glm::vec3(c[0], c[1], c[2]);
+        } else if (std::strncmp(arg, "--render=", 9) == 0) {
+            opts.render = arg + 9;
+        } else if (std::strncmp(arg, "--render-every=", 15) == 0) {
+            opts.renderEvery = std::max<uint64_t>(1, std::strtoull(arg + 15, nullptr, 10));
+        } else if (std::strncmp(arg, "--render-size=", 14) == 0) {
+            std::sscanf(arg + 14, "%dx%d", &opts.renderWidth, &opts.renderHeight);
+        } else if (std::strncmp(arg, "--exposure=", 11) == 0) {
+            opts.exposure = std::strtof(arg + 11, nullptr);
+        } else if (std::strncmp(arg, "--capture=", 10) == 0) {
+            opts.capture = arg + 10;
+        } else if (std::strncmp(arg, "--capture-fps=", 14) == 0) {
+            opts.captureFps = std::max(1, std::atoi(arg + 14));
+        } else if (std::strncmp(arg, "--shader-cache=", 15) == 0) {
+            opts.shaderCache = arg + 15;
+        } else if (std::strcmp(arg, "--preview") == 0) {
+            opts.preview = true;
+        } else if (std::strncmp(arg, "--preview=", 10) == 0) {
+            opts.preview = true;
+            opts.previewMs = std::strtod(arg + 10, nullptr);
+        } else if (std::strcmp(arg, "--interpolate") == 0) {
+            opts.interpolate = true;
+        } else if (std::strcmp(arg, "--hdr") == 0) {
+            opts.hdr = true;
+        } else if (std::strcmp(arg, "--headless") == 0) {
+            opts.headless = true;
+        } else if (std::strncmp(arg, "--dt=", 5) == 0) {
+            opts.fixedDt = std::strtod(arg + 5, nullptr);
+        } else if (std::strncmp(arg, "--frames=", 9) == 0) {
+            opts.frames = std::strtoull(arg + 9, nullptr, 10);
+        } else if (std::strncmp(arg, "--gadget-format=", 16) == 0) {
+            opts.gadgetFormat = std::atoi(arg + 16) == 1 ? 1 : 2;
+        } else {
+            std::cerr << "Ignoring unknown argument: " << arg << std::endl;
+        }
+    }
+    return opts;
+}
+
+int main(int argc, char** argv) {
+    SimOptions opts = parseOptions(argc, argv);
+
     // Print current working directory to help diagnose relative paths at runtime
     try {
         std::cout << "CWD: " << std::filesystem::current_path().string() << std::endl;
     } catch (...) {
         // ignore if filesystem throws
     }
+    // Headless runs (no GPU) never touch GLFW or GL: they step at a fixed dt and
+    // produce images only through the software renderer (--render)
+    const bool headless = opts.headless;
+    if (headless) {
+        if (opts.frames == 0) {
+            std::cerr << "--headless needs --frames=N" << std::endl;
+            return -1;
+        }
+        if (opts.lod || opts.cull || opts.hdr || !opts.capture.empty())
+            std::cerr << "--lod / --cull / --hdr / --capture apply to the GL renderer; ignored with --headless"
+                      << std::endl;
+        opts.lod = false;
+        opts.cull = false;
+        opts.hdr = false;
+        opts.interpolate = false;
+        opts.capture.clear();
+        if (opts.fixedDt <= 0.0) opts.fixedDt = 1.0 / 60.0;
+    }
+
     // 1. Initialize GLFW (creates OpenGL context later)
-    if (!glfwInit()) {
-        std::cerr << "GLFW init failed\n";
-        return -1;
+    GLFWwindow* win = nullptr;
+    if (!headless) {
+        if (!glfwInit()) {
+            std::cerr << "GLFW init failed (use --headless on machines without a display)\n";
+            return -1;
+        }
+
+        // Request OpenGL 3.3 core profile
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        // 2. Create a window + context
+        win = glfwCreateWindow(1280, 720, "N-Body Baseline", nullptr, nullptr);
+        if (!win) {
+            std::cerr << "Window creation failed\n";
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(win);
+        glfwSwapInterval(1); // vsync
+
+        // 3. Initialize GLAD after context is current
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            std::cerr << "GLAD init failed\n";
+            return -1;
+        }
+
+        // Basic GL state
+        glEnable(GL_PROGRAM_POINT_SIZE); // allow setting gl_PointSize in shader
+        glEnable(GL_BLEND);
+        // Additive-like blending for glow; alpha is used as weight
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // deep space background
     }
 
-    // Request OpenGL 3.3 core profile
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // 4. Generate particle data (disk galaxy, or an equilibrium model), or resume a checkpoint
+    //    (on a worker thread, overlapping shader compilation: see 6a)
+    double simTime = 0.0;   // simulated time so far
+    uint64_t stepCount = 0; // physics steps so far
+    std::vector<Particle> particles;
+    SnapshotIOOptions ioOpts;
+    ioOpts.directIO = opts.directIO;
+    ioOpts.backend = opts.io;
+    Replay replay;
+    const bool replaying = !opts.replay.empty();
+    FrameStreamClient streamView;
+    const bool viewing = !opts.viewStream.empty() && !replaying;
+    if (replaying || viewing) {
+        // Playback only: nothing is integrated, so nothing new is written either
+        if (!opts.checkpoint.empty() || !opts.record.empty() || !opts.series.empty() || !opts.gadgetOut.empty() ||
+            !opts.outOfCore.empty() || !opts.stream.empty())
+            std::cerr << "--replay / --view-stream only display; ignoring output and out-of-core options" << std::endl;
+        opts.checkpoint.clear();
+        opts.record.clear();
+        opts.series.clear();
+        opts.gadgetOut.clear();
+        opts.outOfCore.clear();
+        opts.stream.clear();
+        opts.integrator = IntegratorKind::Euler; // no integrator state to set up
+        opts.interpolate = false;                // nothing is stepped
+    }
+    if (opts.preview && (opts.lod || opts.cull || opts.interpolate)) {
+        std::cerr << "--preview draws the full-detail path; ignored with --lod / --cull / --interpolate" << std::endl;
+        opts.preview = false;
+    }
+    if (opts.interpolate && (opts.lod || opts.cull || !opts.render.empty())) {
+        // Those read the particles every frame; with --interpolate only the physics thread does
+        std::cerr << "--lod / --cull / --render are not available with --interpolate; ignoring them" << std::endl;
+        opts.lod = false;
+        opts.cull = false;
+        opts.render.clear();
+    }
+    OutOfCoreTracers outOfCore;
+    const bool ooc = !opts.outOfCore.empty();
+    // Built on a worker thread while this thread, which owns the GL context, compiles or
+    // loads the shader programs, so a cold start waits for the slower of the two, not both
+    auto loadInitialConditions = [&]() -> bool {
+        if (replaying) {
+            if (!replay.open(opts.replay) || !replay.sample(replay.startTime(), particles)) {
+                return false;
+            }
+            simTime = replay.startTime();
+        } else if (viewing) {
+            if (!streamView.connect(opts.viewStream) || !streamView.waitFirst(10.0) ||
+                !streamView.poll(particles, &simTime)) {
+                std::cerr << "No frames received from " << opts.viewStream << std::endl;
+                return false;
+            }
+            std::cout << "Viewing " << particles.size() << " streamed particles from " << opts.viewStream << std::endl;
+        } else if (ooc) {
+            // Tracers go to a file-backed store; `particles` holds the sources plus a preview sample
+            if (!opts.restart.empty() || opts.ic != "disk" || (opts.hasIntegrator && opts.integrator != IntegratorKind::Tracers))
+                std::cerr << "--out-of-core runs tracer mode on a fresh disk; ignoring --restart / --ic / --integrator" << std::endl;
+            if (!opts.checkpoint.empty() || !opts.gadgetOut.empty()) {
+                std::cerr << "Checkpoints and GADGET output are not written in out-of-core mode" << std::endl;
+                opts.checkpoint.clear();
+                opts.gadgetOut.clear();
+            }
+            if (!opts.record.empty()) {
+                // `particles` is only the sources plus a preview sample, so its indices are not tracer ids
+                std::cerr << "--record is not available in out-of-core mode" << std::endl;
+                opts.record.clear();
+            }
+            opts.integrator = IntegratorKind::Tracers;
+            if (!opts.hasSeed) {
+                std::random_device rd;
+                opts.seed = ((uint64_t)rd() << 32) | rd();
+            }
+            std::cout << "Seed: " << opts.seed << " (pass --seed=" << opts.seed << " to reproduce)" << std::endl;
+            OutOfCoreParams oocParams;
+            oocParams.tileParticles = opts.tileParticles;
+            const size_t nMassive = std::min(opts.massive, opts.particles);
+            if (!oocInit(outOfCore, opts.outOfCore.c_str(), nMassive, opts.particles - nMassive, opts.seed,
+                         TracerParams{}, oocParams, particles)) {
+                return false;
+            }
+        } else if (!opts.restart.empty()) {
+            // io_uring: queued chunked reads; otherwise map the file and copy out of the mapping
+            SnapshotHeader header;
+            bool loaded = false;
+            if (isCompressedSnapshot(opts.restart.c_str())) {
+                CompressedHeader ch;
+                loaded = readCompressedSnapshot(opts.restart.c_str(), particles, ch);
+                header.time = ch.time;
+                header.step = ch.step;
+                header.seed = ch.seed;
+                header.integrator = ch.integrator;
+                header.massive = ch.massive;
+            } else if (opts.io == IOBackend::IoUring) {
+                loaded = readSnapshot(opts.restart.c_str(), particles, header, ioOpts);
+            } else {
+                Snapshot snap;
+                loaded = openSnapshot(opts.restart.c_str(), snap);
+                if (loaded) {
+                    snapshotToParticles(snap, particles);
+                    header = *snap.header;
+                }
+            }
+            if (!loaded) {
+                return false;
+            }
+            if (header.integrator >= kIntegratorKinds) {
+                std::cerr << "Unknown integrator " << header.integrator << " in checkpoint " << opts.restart << std::endl;
+                return false;
+            }
+            simTime = header.time;
+            stepCount = header.step;
+            opts.seed = header.seed;
+            if (!opts.hasIntegrator) opts.integrator = static_cast<IntegratorKind>(header.integrator);
+            if (!opts.hasMassive && header.massive > 0) opts.massive = header.massive;
+            std::cout << "Resumed " << particles.size() << " particles at t=" << simTime
+                      << " (step " << stepCount << ") from " << opts.restart << std::endl;
+        } else {
+            if (!opts.hasSeed) {
+                std::random_device rd;
+                opts.seed = ((uint64_t)rd() << 32) | rd();
+            }
+            std::cout << "Seed: " << opts.seed << " (pass --seed=" << opts.seed << " to reproduce)" << std::endl;
+            GalaxyModel galaxy;
+            if (opts.ic == "disk") {
+                particles = makeDiskGalaxy(opts.particles, opts.seed);
+            } else if (opts.ic.compare(0, 7, "gadget:") == 0) {
+                GadgetHeader gh;
+                if (!readGadget(opts.ic.c_str() + 7, particles, &gh)) {
+                    return false;
+                }
+                simTime = gh.time;
+                std::cout << "Loaded " << particles.size() << " particles from GADGET file(s) "
+                          << opts.ic.substr(7) << std::endl;
+            } else if (galaxyPreset(opts.ic.c_str(), opts.particles, galaxy)) {
+                particles = makeGalaxy(galaxy, opts.seed);
+            } else {
+                std::cerr << "Unknown initial condition '" << opts.ic << "', using disk" << std::endl;
+                particles = makeDiskGalaxy(opts.particles, opts.seed);
+            }
+        }
+        return true;
+    };
+    std::future<bool> icReady = std::async(std::launch::async, loadInitialConditions);
 
-    // 2. Create a window + context
-    GLFWwindow* win = glfwCreateWindow(1280, 720, "N-Body Baseline", nullptr, nullptr);
-    if (!win) {
-        std::cerr << "Window creation failed\n";
-        glfwTerminate();
+    // 6a. Shader programs (vertex + fragment), from the binary cache when it has them
+    GLuint prog = 0, lodProg = 0, tonemapProg = 0, hermiteProg = 0;
+    if (!headless) {
+        prog = makeProgram("shaders/particle.vert", "shaders/particle.frag", opts.shaderCache);
+        if (opts.lod) lodProg = makeProgram("shaders/lod.vert", "shaders/lod.frag", opts.shaderCache);
+        if (opts.hdr) tonemapProg = makeProgram("shaders/tonemap.vert", "shaders/tonemap.frag", opts.shaderCache);
+        if (opts.interpolate)
+            hermiteProg = makeProgram("shaders/hermite.vert", "shaders/particle.frag", opts.shaderCache);
+    }
+    if (!icReady.get()) {
+        if (win) {
+            glfwDestroyWindow(win);
+            glfwTerminate();
+        }
         return -1;
     }
-    glfwMakeContextCurrent(win);
-    glfwSwapInterval(1); // vsync
 
-    // 3. Initialize GLAD after context is current
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "GLAD init failed\n";
-        return -1;
+    // Wisdom-Holman and IAS15 keep their own double-precision copy of the state;
+    // tracer mode keeps one for the massive sources only
+    WHState wh;
+    IASState ias;
+    TracerState tracers;
+    if (opts.integrator == IntegratorKind::WisdomHolman) {
+        whInit(wh, particles, WHParams{});
+    } else if (opts.integrator == IntegratorKind::IAS15) {
+        iasInit(ias, particles, IASParams{});
+    } else if (opts.integrator == IntegratorKind::Tracers && !ooc) {
+        // Sources are the first N particles: a fair sample of the (randomly ordered) disk,
+        // or the leading component of a galaxy model
+        tracerInit(tracers, particles, opts.massive, TracerParams{});
+        for (size_t i = 0; i < tracers.nMassive; ++i)
+            particles[i].color = glm::vec3(1.0f); // sources drawn white
     }
 
-    // Basic GL state
-    glEnable(GL_PROGRAM_POINT_SIZE); // allow setting gl_PointSize in shader
-    glEnable(GL_BLEND);
-    // Additive-like blending for glow; alpha is used as weight
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // deep space background
+    // Tracer-mode checkpoints record how many sources lead the array, so a restart splits it the same way
+    const uint32_t savedMassive = opts.integrator == IntegratorKind::Tracers
+                                ? (uint32_t)std::min(opts.massive, ooc ? opts.particles : particles.size())
+                                : 0;
 
-    // 4. Generate particle data (disk galaxy)
-    auto particles = makeDiskGalaxy(3000);
+    // Checkpoints are written by a background thread from a copy of the particles,
+    // so periodic snapshots never stall stepping
+    std::unique_ptr<AsyncSnapshotWriter> checkpointWriter;
+    if (!opts.checkpoint.empty()) {
+        CompressOptions codec;
+        codec.posError = opts.compressError;
+        codec.velError = opts.compressVelError > 0.0 ? opts.compressVelError : opts.compressError;
+        // Restarts must see every particle at its own index: tracer sources stay first, and
+        // --record trajectories identify particles by index across runs
+        codec.keepOrder = true;
+        checkpointWriter = std::make_unique<AsyncSnapshotWriter>(ioOpts, opts.compressError > 0.0 ? &codec : nullptr);
+    }
+    auto saveCheckpoint = [&]() {
+        SnapshotMeta meta;
+        meta.time = simTime;
+        meta.step = stepCount;
+        meta.seed = opts.seed;
+        meta.integrator = static_cast<uint32_t>(opts.integrator);
+        meta.massive = savedMassive;
+        if (!checkpointWriter->submit(opts.checkpoint, particles, meta))
+            std::cerr << "Checkpoint skipped at step " << stepCount << " (writer busy)" << std::endl;
+    };
 
-    // 5. Create GPU buffers (VAO + VBO)
-    GLuint vao = 0, vbo = 0;
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
+    // Keyframe series for --replay: every seriesEvery steps a full snapshot plus an index line
+    std::unique_ptr<AsyncSnapshotWriter> seriesWriter;
+    if (!opts.series.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(opts.series, ec);
+        if (ec)
+            std::cerr << "Cannot create series directory " << opts.series << ": " << ec.message() << std::endl;
+        else
+            seriesWriter = std::make_unique<AsyncSnapshotWriter>(ioOpts, nullptr, ""); // quiet: one file per keyframe
+        opts.seriesEvery = std::max<uint64_t>(1, opts.seriesEvery);
+    }
+    auto saveKeyframe = [&]() {
+        SnapshotMeta meta;
+        meta.time = simTime;
+        meta.step = stepCount;
+        meta.seed = opts.seed;
+        meta.integrator = static_cast<uint32_t>(opts.integrator);
+        meta.massive = savedMassive;
+        const std::string name = seriesKeyframeName(stepCount);
+        if (!seriesWriter->submit((std::filesystem::path(opts.series) / name).string(), particles, meta))
+            std::cerr << "Keyframe skipped at step " << stepCount << " (writer busy)" << std::endl;
+        else if (!appendSeriesIndex(opts.series, simTime, stepCount, name))
+            std::cerr << "Failed to update series index in " << opts.series << std::endl;
+    };
+    if (seriesWriter)
+        saveKeyframe(); // the series starts at the initial state
 
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    // Full-cadence orbits of a few selected particles, flushed in the background
+    TrajectoryRecorder recorder;
+    if (!opts.record.empty()) {
+        std::string spec = opts.recordIds;
+        if (spec.empty() && !particles.empty())
+            spec = "0-" + std::to_string(particles.size() - 1) + ":" + std::to_string(std::max<size_t>(1, particles.size() / 1024));
+        std::vector<uint64_t> ids = parseParticleSelection(spec, particles.size());
+        if (ids.empty())
+            std::cerr << "No particles selected for --record" << std::endl;
+        else if (recorder.open(opts.record.c_str(), ids))
+            std::cout << "Recording " << ids.size() << " trajectories to " << opts.record << std::endl;
+    }
+
+    // Every frame published to other processes through shared memory; never waits for them
+    LiveExporter live;
+    if (!opts.live.empty() && live.create(opts.live, particles.size(), opts.liveSlots))
+        std::cout << "Publishing live frames as '" << opts.live << "'" << std::endl;
 
-    // Upload all particle structs in one contiguous block
-    glBufferData(GL_ARRAY_BUFFER, particles.size() * sizeof(Particle), particles.data(), GL_DYNAMIC_DRAW);
+    // Quantized frames to a remote viewer; frames are dropped, never waited for, when it falls behind
+    FrameStreamServer streamOut;
+    if (!opts.stream.empty() && streamOut.listen(opts.stream))
+        std::cout << "Streaming frames on " << opts.stream << std::endl;
 
-    // Vertex attribute 0: position (first 3 floats)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, pos));
-    glEnableVertexAttribArray(0);
+    // 5. Create GPU buffers: a VAO over a streaming VBO of quantized positions, refilled each
+    // frame, and a static VBO of colors, uploaded only when the particle count changes
+    GLuint vao = 0, colorVbo = 0;
+    StreamingBuffer vertexStream;
+    std::vector<uint32_t> packedColors;
+    size_t colorCount = 0;
+    if (!headless) {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &colorVbo);
+        vertexStream.create(sizeof(PackedVertex), particles.size(), opts.upload);
+        std::cout << "Vertex upload: " << (vertexStream.persistent() ? "persistent mapped ring" : "orphaned buffer")
+                  << std::endl;
+    }
 
-    // Vertex attribute 1: color (next 3 floats)
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, color));
-    glEnableVertexAttribArray(1);
+    // (Re)point the attributes at the VBO; needed again whenever the VBO is replaced
+    auto setParticleAttributes = [&]() {
+        glBindVertexArray(vao);
 
-    glBindVertexArray(0); // unbind VAO for safety
+        // Vertex attribute 0: position (3 normalized unsigned shorts, unpacked with the frame's box);
+        // re-pointed at the current ring region every frame
+        glBindBuffer(GL_ARRAY_BUFFER, vertexStream.buffer());
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)0);
+        glEnableVertexAttribArray(0);
 
-    // 6. Build shader program (vertex + fragment)
-    GLuint prog = makeProgram("shaders/particle.vert", "shaders/particle.frag");
-    if (prog == 0) {
-        std::cerr << "Aborting: shader program not created." << std::endl;
-        glfwDestroyWindow(win);
-        glfwTerminate();
-        return -1;
+        // Vertex attribute 1: color (RGBA8 from the static buffer)
+        glBindBuffer(GL_ARRAY_BUFFER, colorVbo);
+        glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(uint32_t), (void*)0);
+        glEnableVertexAttribArray(1);
+
+        glBindVertexArray(0); // unbind VAO for safety
+    };
+    if (!headless)
+        setParticleAttributes();
+
+    // LOD mode draws its own per-frame point set (near particles + one splat per screen tile)
+    // from a second streaming VBO of full-precision LodVertex
+    GLuint lodVao = 0;
+    StreamingBuffer lodStream;
+    LodBuilder lod;
+    std::vector<LodVertex> lodPoints;
+    auto setLodAttributes = [&]() {
+        glBindVertexArray(lodVao);
+        glBindBuffer(GL_ARRAY_BUFFER, lodStream.buffer());
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(LodVertex), (void*)offsetof(LodVertex, pos));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(LodVertex), (void*)offsetof(LodVertex, color));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(LodVertex), (void*)offsetof(LodVertex, size));
+        glEnableVertexAttribArray(2);
+        glBindVertexArray(0);
+    };
+    if (opts.lod) {
+        glGenVertexArrays(1, &lodVao);
+        lodStream.create(sizeof(LodVertex), 1u << 16, opts.upload);
+        setLodAttributes();
+    }
+
+    // Frustum culling over a Morton-ordered octree of the particles (full-detail path only)
+    CullingOctree culling;
+    CullRanges cullRanges;
+    uint64_t framesSinceSort = 0;
+    double visibleSum = 0.0, rangeSum = 0.0;
+
+    // Preview: the first K of a fixed random permutation, K steered by the measured render time
+    PreviewSampler preview;
+    GpuTimer drawTimer;
+    double sampledSum = 0.0;
+    if (opts.preview)
+        drawTimer.create();
+
+    // 6b. Uniform locations of the programs built alongside the initial conditions
+    GLint uMVP = -1, uCamPos = -1, uPointSize = -1, uBoxOrigin = -1, uBoxExtent = -1, uColorMode = -1,
+          uColorRadius = -1, uSampleScale = -1;
+    if (!headless) {
+        if (prog == 0) {
+            std::cerr << "Aborting: shader program not created." << std::endl;
+            glfwDestroyWindow(win);
+            glfwTerminate();
+            return -1;
+        }
+        uMVP = glGetUniformLocation(prog, "uMVP"); // uniform location lookup
+        uCamPos = glGetUniformLocation(prog, "uCamPos");
+        uPointSize = glGetUniformLocation(prog, "uPointSize");
+        uBoxOrigin = glGetUniformLocation(prog, "uBoxOrigin");
+        uBoxExtent = glGetUniformLocation(prog, "uBoxExtent");
+        uColorMode = glGetUniformLocation(prog, "uColorMode");
+        uColorRadius = glGetUniformLocation(prog, "uColorRadius");
+        uSampleScale = glGetUniformLocation(prog, "uSampleScale");
+    }
+    GLint uLodMVP = -1, uLodCamPos = -1, uLodPointSize = -1, uLodColorMode = -1, uLodColorRadius = -1;
+    if (opts.lod) {
+        if (lodProg == 0) {
+            std::cerr << "LOD shader program not created; drawing every particle" << std::endl;
+            opts.lod = false;
+        } else {
+            uLodMVP = glGetUniformLocation(lodProg, "uMVP");
+            uLodCamPos = glGetUniformLocation(lodProg, "uCamPos");
+            uLodPointSize = glGetUniformLocation(lodProg, "uPointSize");
+            uLodColorMode = glGetUniformLocation(lodProg, "uColorMode");
+            uLodColorRadius = glGetUniformLocation(lodProg, "uColorRadius");
+        }
     }
-    GLint uMVP = glGetUniformLocation(prog, "uMVP"); // uniform location lookup
-    GLint uCamPos = glGetUniformLocation(prog, "uCamPos");
-    GLint uPointSize = glGetUniformLocation(prog, "uPointSize");
 
-    // 7. Prepare camera matrices (simple, fixed camera)
-    glm::vec3 camPos(0.f, 0.f, 18.f);
+    // HDR: particles blend into a float target; one fullscreen pass tonemaps it into the window
+    HdrTarget hdr;
+    GLint uExposure = -1;
+    if (opts.hdr) {
+        int fbW = 0, fbH = 0;
+        glfwGetFramebufferSize(win, &fbW, &fbH);
+        if (tonemapProg == 0 || !hdr.resize(fbW, fbH)) {
+            std::cerr << "HDR target not available; blending straight into the window" << std::endl;
+            hdr.destroy();
+        } else {
+            glUseProgram(tonemapProg);
+            glUniform1i(glGetUniformLocation(tonemapProg, "uHdr"), 0); // texture unit 0
+            uExposure = glGetUniformLocation(tonemapProg, "uExposure");
+        }
+    }
+
+    // 7. Prepare camera: a fly camera (as in main.cpp) starting at --camera, looking at the origin.
+    // WASD move, Q/E down/up, drag with the right mouse button to look around
+    glm::vec3 camPos = opts.camera;
+    const glm::vec3 toOrigin = glm::length(camPos) > 0.0f ? glm::normalize(-camPos) : glm::vec3(0.0f, 0.0f, -1.0f);
+    float yaw = glm::degrees(std::atan2(toOrigin.z, toOrigin.x)); // -90: looking down -z
+    float pitch = glm::degrees(std::asin(glm::clamp(toOrigin.y, -1.0f, 1.0f)));
+    double lastCursorX = 0.0, lastCursorY = 0.0;
+    bool looking = false;
     glm::mat4 proj = glm::perspective(glm::radians(45.f), 1280.f / 720.f, 0.1f, 100.f);
 
-    // Animation timing
-    double lastTime = glfwGetTime();
+    // Software-rendered PNG frames (the same camera, at the render size's aspect)
+    SplatRenderer splats;
+    uint64_t renderedFrames = 0;
+    double renderMsSum = 0.0;
+    if (!opts.render.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(opts.render, ec);
+        if (ec) {
+            std::cerr << "Cannot create render directory " << opts.render << ": " << ec.message() << std::endl;
+            opts.render.clear();
+        } else {
+            splats.resize(opts.renderWidth, opts.renderHeight);
+            std::cout << "Rendering every " << opts.renderEvery << " frame(s) at " << splats.width() << "x"
+                      << splats.height() << " to " << opts.render << std::endl;
+        }
+    }
+    const glm::mat4 renderProj = glm::perspective(glm::radians(45.f), (float)std::max(opts.renderWidth, 1) /
+                                                  (float)std::max(opts.renderHeight, 1), 0.1f, 100.f);
+
+    // Window recording through a PBO ring and an encoder thread (never stalls the loop)
+    FrameCapture capture;
+    if (!opts.capture.empty()) {
+        int fbW = 0, fbH = 0;
+        glfwGetFramebufferSize(win, &fbW, &fbH);
+        if (capture.open(opts.capture, fbW, fbH, opts.captureFps))
+            std::cout << "Capturing " << fbW << "x" << fbH << " frames to " << opts.capture << std::endl;
+    }
+
+    // Animation timing: GLFW's clock, or a steady clock when there is no GLFW
+    const auto clockStart = std::chrono::steady_clock::now();
+    auto clockSeconds = [&]() {
+        if (!headless) return glfwGetTime();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - clockStart).count();
+    };
+    double lastTime = clockSeconds();
+
+    // Replay controls: Space pauses, Left/Right scrub through the whole run in ~10 s
+    double replayTime = simTime;
+    bool replayPaused = false;
+    bool spaceWasDown = false;
+
+    double frameStart = lastTime;
+    double frameMsSum = 0.0, frameMsMax = 0.0;
+    uint64_t frameCount = 0;
+
+    // One physics step, and what follows every step (recording, publishing, checkpoints)
+    auto advancePhysics = [&](float dt) {
+        if (opts.integrator == IntegratorKind::WisdomHolman) {
+            whStep(wh, dt);
+            whStore(wh, particles);
+        } else if (opts.integrator == IntegratorKind::IAS15) {
+            iasAdvance(ias, dt); // adaptive: as many internal steps as accuracy demands
+            iasStore(ias, particles);
+        } else if (ooc) {
+            oocStep(outOfCore, particles, dt); // streams every tile; particles = sources + preview
+        } else if (opts.integrator == IntegratorKind::Tracers) {
+            tracerStep(tracers, particles, dt);
+        } else {
+            stepParticles(particles, dt);
+        }
+        simTime += dt;
+        ++stepCount;
+    };
+    auto afterStep = [&]() {
+        if (recorder.isOpen())
+            recorder.record(particles.data(), simTime, stepCount);
+        if (live.isOpen())
+            live.publish(particles.data(), particles.size(), simTime, stepCount);
+        if (streamOut.isOpen())
+            streamOut.submit(particles.data(), particles.size(), simTime, stepCount);
+        if (checkpointWriter && opts.checkpointEvery > 0 && stepCount % opts.checkpointEvery == 0)
+            saveCheckpoint();
+        if (seriesWriter && stepCount % opts.seriesEvery == 0)
+            saveKeyframe();
+    };
+
+    // --interpolate: physics steps on its own thread, as fast as it can, and publishes each
+    // completed step (positions and velocities). The render loop keeps the last two on the GPU
+    // and hermite.vert blends between them, paced by the wall time the last step took, so the
+    // view stays smooth at the display rate however slow steps are; it runs one step behind.
+    // From here on only the physics thread touches `particles`
+    GLuint interpVao = 0, stateVbo[2] = {0, 0};
+    int newerState = 0;                    // stateVbo index of the newer step
+    double stateTime[2] = {0.0, 0.0};      // simulated time of [older, newer]
+    double stateWall[2] = {0.0, 0.0};      // when they were published
+    std::vector<StateVertex> publishedState, receivedState;
+    double publishedTime = 0.0, publishedWall = 0.0;
+    uint64_t publishedSteps = 0, receivedSteps = 0;
+    std::mutex publishMutex;
+    std::condition_variable stateTaken;   // the render loop picked up the last published step
+    std::atomic<bool> stopPhysics{false};
+    std::thread physics;
+    const size_t interpCount = particles.size();
+    const uint64_t firstStep = stepCount;
+    double physicsStart = 0.0;
+    GLint uHermiteMVP = -1, uHermiteCamPos = -1, uHermitePointSize = -1, uHermiteColorMode = -1,
+          uHermiteColorRadius = -1, uBlend = -1, uStepTime = -1;
+    auto setStateAttributes = [&]() {
+        glBindVertexArray(interpVao);
+        const GLuint older = stateVbo[1 - newerState], newer = stateVbo[newerState];
+        glBindBuffer(GL_ARRAY_BUFFER, older);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StateVertex), (void*)offsetof(StateVertex, pos));
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(StateVertex), (void*)offsetof(StateVertex, vel));
+        glBindBuffer(GL_ARRAY_BUFFER, newer);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(StateVertex), (void*)offsetof(StateVertex, pos));
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(StateVertex), (void*)offsetof(StateVertex, vel));
+        glBindVertexArray(0);
+    };
+    if (opts.interpolate) {
+        if (hermiteProg == 0) {
+            std::cerr << "Interpolation shader program not created; stepping once per frame" << std::endl;
+            opts.interpolate = false;
+        } else {
+            uHermiteMVP = glGetUniformLocation(hermiteProg, "uMVP");
+            uHermiteCamPos = glGetUniformLocation(hermiteProg, "uCamPos");
+            uHermitePointSize = glGetUniformLocation(hermiteProg, "uPointSize");
+            uHermiteColorMode = glGetUniformLocation(hermiteProg, "uColorMode");
+            uHermiteColorRadius = glGetUniformLocation(hermiteProg, "uColorRadius");
+            uBlend = glGetUniformLocation(hermiteProg, "uBlend");
+            uStepTime = glGetUniformLocation(hermiteProg, "uStepTime");
+        }
+    }
+    if (opts.interpolate) {
+        // Both slots start as the initial state; colors are static, so they are sent once here
+        packedColors.resize(interpCount);
+        packColors(particles.data(), interpCount, packedColors.data());
+        glBindBuffer(GL_ARRAY_BUFFER, colorVbo);
+        glBufferData(GL_ARRAY_BUFFER, packedColors.size() * sizeof(uint32_t), packedColors.data(), GL_STATIC_DRAW);
+        publishedState.resize(interpCount);
+        receivedState.resize(interpCount);
+        packStates(particles.data(), interpCount, receivedState.data());
+        glGenVertexArrays(1, &interpVao);
+        glGenBuffers(2, stateVbo);
+        for (GLuint vbo : stateVbo) {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferData(GL_ARRAY_BUFFER, interpCount * sizeof(StateVertex), receivedState.data(), GL_STREAM_DRAW);
+        }
+        glBindVertexArray(interpVao);
+        glBindBuffer(GL_ARRAY_BUFFER, colorVbo);
+        glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(uint32_t), (void*)0);
+        for (GLuint a = 0; a <= 4; ++a) glEnableVertexAttribArray(a);
+        setStateAttributes();
+        stateTime[0] = stateTime[1] = simTime;
+        stateWall[0] = stateWall[1] = physicsStart = clockSeconds();
+
+        physics = std::thread([&]() {
+            std::vector<StateVertex> staging(interpCount);
+            double last = clockSeconds();
+            while (!stopPhysics.load(std::memory_order_relaxed)) {
+                const double now = clockSeconds();
+                const float dt = opts.fixedDt > 0.0 ? static_cast<float>(opts.fixedDt)
+                                                    : static_cast<float>(glm::min(now - last, 0.033));
+                last = now;
+                advancePhysics(dt);
+                afterStep();
+                packStates(particles.data(), interpCount, staging.data());
+                // At most one step ahead of the display: cheap physics does not spin through tiny steps
+                std::unique_lock<std::mutex> lock(publishMutex);
+                stateTaken.wait(lock, [&] {
+                    return receivedSteps == publishedSteps || stopPhysics.load(std::memory_order_relaxed);
+                });
+                publishedState.swap(staging);
+                publishedTime = simTime;
+                publishedWall = clockSeconds();
+                ++publishedSteps;
+            }
+        });
+    }
 
     // 8. Main loop
-    while (!glfwWindowShouldClose(win)) {
+    bool running = true;
+    while (running && (headless || !glfwWindowShouldClose(win))) {
         // Handle simple input: ESC to exit
-        if (glfwGetKey(win, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        if (win && glfwGetKey(win, GLFW_KEY_ESCAPE) == GLFW_PRESS)
             glfwSetWindowShouldClose(win, 1);
 
-    // Integrate physics (fixed-ish timestep clamped for stability)
-    double now = glfwGetTime();
+    // Integrate physics (fixed-ish timestep clamped for stability, or --dt)
+    double now = clockSeconds();
     float dt = static_cast<float>(glm::min(now - lastTime, 0.033)); // <= ~30 FPS max step
+    if (opts.fixedDt > 0.0) dt = static_cast<float>(opts.fixedDt);
     lastTime = now;
-    stepParticles(particles, dt);
+    if (replaying) {
+        const bool spaceDown = win && glfwGetKey(win, GLFW_KEY_SPACE) == GLFW_PRESS;
+        if (spaceDown && !spaceWasDown) replayPaused = !replayPaused;
+        spaceWasDown = spaceDown;
+        const double scrub = (replay.endTime() - replay.startTime()) / 10.0 * dt;
+        if (win && glfwGetKey(win, GLFW_KEY_RIGHT) == GLFW_PRESS) replayTime += scrub;
+        else if (win && glfwGetKey(win, GLFW_KEY_LEFT) == GLFW_PRESS) replayTime -= scrub;
+        else if (!replayPaused) replayTime += dt;
+        if (replayTime > replay.endTime()) replayTime = replay.startTime(); // loop
+        if (replayTime < replay.startTime()) replayTime = replay.startTime();
+        replay.sample(replayTime, particles);
+        simTime = replayTime;
+    } else if (viewing) {
+        streamView.poll(particles, &simTime); // keeps the last frame once the stream ends
+    } else if (!opts.interpolate) {
+        advancePhysics(dt);
+    }
+    if (!opts.interpolate)
+        afterStep();
+
+    // Fly camera
+    if (win && glfwGetMouseButton(win, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+        double x = 0.0, y = 0.0;
+        glfwGetCursorPos(win, &x, &y);
+        if (looking) {
+            yaw += 0.1f * (float)(x - lastCursorX);
+            pitch = glm::clamp(pitch - 0.1f * (float)(y - lastCursorY), -89.0f, 89.0f);
+        }
+        lastCursorX = x;
+        lastCursorY = y;
+        looking = true;
+    } else {
+        looking = false;
+    }
+    const glm::vec3 camFront = glm::normalize(glm::vec3(std::cos(glm::radians(yaw)) * std::cos(glm::radians(pitch)),
+                                                        std::sin(glm::radians(pitch)),
+                                                        std::sin(glm::radians(yaw)) * std::cos(glm::radians(pitch))));
+    const glm::vec3 camUp(0.0f, 1.0f, 0.0f);
+    const glm::vec3 camRight = glm::normalize(glm::cross(camFront, camUp));
+    const float camStep = 8.0f * dt;
+    if (win) {
+        if (glfwGetKey(win, GLFW_KEY_W) == GLFW_PRESS) camPos += camStep * camFront;
+        if (glfwGetKey(win, GLFW_KEY_S) == GLFW_PRESS) camPos -= camStep * camFront;
+        if (glfwGetKey(win, GLFW_KEY_A) == GLFW_PRESS) camPos -= camStep * camRight;
+        if (glfwGetKey(win, GLFW_KEY_D) == GLFW_PRESS) camPos += camStep * camRight;
+        if (glfwGetKey(win, GLFW_KEY_E) == GLFW_PRESS) camPos += camStep * camUp;
+        if (glfwGetKey(win, GLFW_KEY_Q) == GLFW_PRESS) camPos -= camStep * camUp;
+    }
 
-    // Update GPU positions
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, particles.size() * sizeof(Particle), particles.data());
+    // Build MVP (Model * View * Projection): here model = identity
+    glm::mat4 view = glm::lookAt(camPos, camPos + camFront, camUp);
+    glm::mat4 model(1.f);
+    glm::mat4 mvp = proj * view * model;
+
+    // Software frame: rendered on all cores and written before the GL frame is drawn
+    if (!opts.render.empty() && frameCount % opts.renderEvery == 0) {
+        const double renderStart = clockSeconds();
+        SplatView splatView;
+        splatView.viewProj = renderProj * view * model;
+        splatView.camPos = camPos;
+        splatView.colorByRadius = opts.colorByRadius;
+        splatView.exposure = opts.exposure;
+        splats.render(particles.data(), particles.size(), splatView);
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%06llu.png", (unsigned long long)renderedFrames);
+        writePng((std::filesystem::path(opts.render) / name).string().c_str(), splats.width(), splats.height(),
+                 splats.rgb());
+        ++renderedFrames;
+        renderMsSum += 1000.0 * (clockSeconds() - renderStart);
+    }
+
+    // With --hdr both draw paths below blend into the float target instead of the window
+    if (hdr.valid()) {
+        int fbW = 0, fbH = 0;
+        glfwGetFramebufferSize(win, &fbW, &fbH);
+        if (hdr.resize(fbW, fbH)) hdr.bind();
+    }
+
+    if (headless) {
+        // nothing to draw or present
+    } else if (opts.interpolate) {
+        // A newer step replaces the older of the two on the GPU (orphaned: frames in flight keep theirs)
+        bool fresh = false;
+        {
+            std::lock_guard<std::mutex> lock(publishMutex);
+            if (publishedSteps != receivedSteps) {
+                receivedState.swap(publishedState);
+                receivedSteps = publishedSteps;
+                stateTime[0] = stateTime[1];
+                stateWall[0] = stateWall[1];
+                stateTime[1] = publishedTime;
+                stateWall[1] = publishedWall;
+                fresh = true;
+            }
+        }
+        if (fresh) stateTaken.notify_one();
+        if (fresh) {
+            newerState = 1 - newerState;
+            glBindBuffer(GL_ARRAY_BUFFER, stateVbo[newerState]);
+            glBufferData(GL_ARRAY_BUFFER, interpCount * sizeof(StateVertex), receivedState.data(), GL_STREAM_DRAW);
+            setStateAttributes();
+        }
+        // Cover the older -> newer step in the wall time it took to arrive; hold at the newer one if the
+        // next is late (never extrapolate past it: the next step would snap back)
+        const double span = stateWall[1] - stateWall[0];
+        const float blend = span > 0.0 ? (float)glm::clamp((clockSeconds() - stateWall[1]) / span, 0.0, 1.0) : 1.0f;
 
-    // Clear frame
         glClear(GL_COLOR_BUFFER_BIT);
+        glUseProgram(hermiteProg);
+        glUniformMatrix4fv(uHermiteMVP, 1, GL_FALSE, &mvp[0][0]);
+        glUniform3fv(uHermiteCamPos, 1, &camPos[0]);
+        glUniform1f(uHermitePointSize, 6.0f);
+        glUniform1i(uHermiteColorMode, opts.colorByRadius ? 1 : 0);
+        glUniform1f(uHermiteColorRadius, 8.0f);
+        glUniform1f(uBlend, blend);
+        glUniform1f(uStepTime, (float)(stateTime[1] - stateTime[0]));
+        glBindVertexArray(interpVao);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)interpCount);
+    } else if (opts.lod) {
+        // Near particles and far tiles, copied whole into this frame's region of the LOD ring
+        int fbW = 0, fbH = 0;
+        glfwGetFramebufferSize(win, &fbW, &fbH);
+        lod.build(particles.data(), particles.size(), camPos, mvp, fbW, fbH, opts.lodParams, lodPoints);
+        if (lodStream.reserve(lodPoints.size()))
+            setLodAttributes();
+        if (void* dst = lodStream.begin(lodPoints.size()))
+            std::memcpy(dst, lodPoints.data(), lodPoints.size() * sizeof(LodVertex));
+        lodStream.end();
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        glUseProgram(lodProg);
+        glUniformMatrix4fv(uLodMVP, 1, GL_FALSE, &mvp[0][0]);
+        glUniform3fv(uLodCamPos, 1, &camPos[0]);
+        glUniform1f(uLodPointSize, opts.lodParams.pointSize);
+        glUniform1i(uLodColorMode, opts.colorByRadius ? 1 : 0);
+        glUniform1f(uLodColorRadius, 8.0f);
+        glBindVertexArray(lodVao);
+        glDrawArrays(GL_POINTS, (GLint)(lodStream.offset() / sizeof(LodVertex)), (GLsizei)lodPoints.size());
+        lodStream.fence();
+    } else {
+    // Update GPU positions: quantized straight into this frame's region of the streaming VBO
+    // (a streamed run may change its particle count, which grows the VBO and resends colors)
+    // With --cull, vertices are in the octree's Morton draw order, re-sorted every few frames
+    // (and whenever the count changes); the static colors follow the new order.
+    // With --preview, they are in the sampler's random order and only the first K are written
+    const double packStart = clockSeconds();
+    if (vertexStream.reserve(particles.size()))
+        setParticleAttributes();
+    bool colorsStale = colorCount != particles.size();
+    if (opts.preview && preview.size() != particles.size()) {
+        preview.reset(particles.size(), opts.seed);
+        colorsStale = true;
+    }
+    const size_t drawCount = opts.preview ? preview.count() : particles.size();
+    if (opts.cull && (culling.size() != particles.size() || ++framesSinceSort >= opts.cullReorder)) {
+        culling.rebuild(particles.data(), particles.size(), opts.cullLeaf);
+        framesSinceSort = 0;
+        colorsStale = true;
+    }
+    if (colorsStale) {
+        packedColors.resize(particles.size());
+        if (opts.cull)
+            packColors(particles.data(), culling.order().data(), particles.size(), packedColors.data());
+        else if (opts.preview)
+            packColors(particles.data(), preview.order().data(), particles.size(), packedColors.data());
+        else
+            packColors(particles.data(), particles.size(), packedColors.data());
+        glBindBuffer(GL_ARRAY_BUFFER, colorVbo);
+        glBufferData(GL_ARRAY_BUFFER, packedColors.size() * sizeof(uint32_t), packedColors.data(), GL_STATIC_DRAW);
+        colorCount = particles.size();
+    }
+    if (opts.cull)
+        culling.cull(particles.data(), mvp, cullRanges); // only these ranges are written and drawn
+    PackBox box{glm::vec3(0.0f), glm::vec3(1.0f)};
+    if (void* dst = vertexStream.begin(drawCount)) {
+        if (opts.preview) {
+            box = packPositions(particles.data(), preview.order().data(), drawCount, static_cast<PackedVertex*>(dst));
+        } else if (!opts.cull) {
+            box = packPositions(particles.data(), particles.size(), static_cast<PackedVertex*>(dst));
+        } else if (cullRanges.visible > 0) {
+            box.origin = cullRanges.lo;
+            box.extent = glm::max(cullRanges.hi - cullRanges.lo, glm::vec3(1e-6f));
+            packPositions(particles.data(), culling.order().data(), cullRanges.first.data(), cullRanges.count.data(),
+                          cullRanges.first.size(), box, static_cast<PackedVertex*>(dst));
+        }
+    }
+    vertexStream.end();
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexStream.buffer());
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)vertexStream.offset());
+    glBindVertexArray(0);
+    const double packMs = 1000.0 * (clockSeconds() - packStart);
 
-        // Build MVP (Model * View * Projection): here model = identity
-        glm::mat4 view = glm::lookAt(camPos, glm::vec3(0.f), glm::vec3(0, 1, 0));
-        glm::mat4 model(1.f);
-        glm::mat4 mvp = proj * view * model;
+    // Clear frame
+        glClear(GL_COLOR_BUFFER_BIT);
 
         // Use program and set uniform
         glUseProgram(prog);
     glUniformMatrix4fv(uMVP, 1, GL_FALSE, &mvp[0][0]);
     glUniform3fv(uCamPos, 1, &camPos[0]);
     glUniform1f(uPointSize, 6.0f); // base size in pixels
+    glUniform3fv(uBoxOrigin, 1, &box.origin[0]);
+    glUniform3fv(uBoxExtent, 1, &box.extent[0]);
+    glUniform1i(uColorMode, opts.colorByRadius ? 1 : 0);
+    glUniform1f(uColorRadius, 8.0f); // disk radius of makeDiskGalaxy
+    glUniform1f(uSampleScale, opts.preview ? preview.scale() : 1.0f);
 
         // Bind VAO and draw points
         glBindVertexArray(vao);
-        glDrawArrays(GL_POINTS, 0, (GLsizei)particles.size());
+        if (opts.preview) {
+            drawTimer.begin();
+            glDrawArrays(GL_POINTS, 0, (GLsizei)drawCount);
+            drawTimer.end();
+            // The slower side sets the pace: packing on the CPU or drawing on the GPU (a few frames old)
+            preview.update(std::max(packMs, drawTimer.lastMs()), opts.previewMs);
+            sampledSum += (double)drawCount / (double)std::max<size_t>(1, particles.size());
+        } else if (!opts.cull)
+            glDrawArrays(GL_POINTS, 0, (GLsizei)particles.size());
+        else if (!cullRanges.first.empty())
+            glMultiDrawArrays(GL_POINTS, cullRanges.first.data(), cullRanges.count.data(), (GLsizei)cullRanges.first.size());
+        if (opts.cull) {
+            visibleSum += (double)cullRanges.visible / (double)std::max<size_t>(1, particles.size());
+            rangeSum += (double)cullRanges.first.size();
+        }
+        vertexStream.fence(); // this frame's region is reused three frames from now
+    }
+
+        if (hdr.valid()) {
+            glUseProgram(tonemapProg);
+            glUniform1f(uExposure, opts.exposure);
+            hdr.resolve();
+        }
 
         // Present frame + process events
-        glfwSwapBuffers(win);
-        glfwPollEvents();
+        if (win) {
+            if (capture.isOpen()) {
+                int fbW = 0, fbH = 0;
+                glfwGetFramebufferSize(win, &fbW, &fbH);
+                capture.capture(fbW, fbH); // reads the back buffer just drawn
+            }
+            glfwSwapBuffers(win);
+            glfwPollEvents();
+        }
+
+        // Frame time statistics; --frames=N stops after N frames (scripted / headless runs)
+        const double frameEnd = clockSeconds();
+        const double frameMs = 1000.0 * (frameEnd - frameStart);
+        frameStart = frameEnd;
+        frameMsSum += frameMs;
+        frameMsMax = std::max(frameMsMax, frameMs);
+        if (++frameCount == opts.frames)
+            running = false;
+    }
+    if (physics.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(publishMutex);
+            stopPhysics = true;
+        }
+        stateTaken.notify_one();
+        physics.join(); // finishes the step in progress
+        const double seconds = clockSeconds() - physicsStart;
+        std::cout << "Physics thread: " << stepCount - firstStep << " steps, "
+                  << (double)(stepCount - firstStep) / std::max(seconds, 1e-9) << " per second" << std::endl;
     }
+    if (frameCount > 0)
+        std::cout << "Frames: " << frameCount << ", mean " << frameMsSum / (double)frameCount << " ms, worst "
+                  << frameMsMax << " ms" << std::endl;
+    if (frameCount > 0 && opts.cull && !opts.lod)
+        std::cout << "Culling: " << 100.0 * visibleSum / (double)frameCount << "% of particles drawn on average, in "
+                  << rangeSum / (double)frameCount << " ranges of " << culling.leafCount() << " leaves" << std::endl;
+    if (capture.isOpen()) {
+        capture.close();
+        std::cout << "Captured " << capture.captured() << " frames to " << opts.capture << std::endl;
+    }
+    if (frameCount > 0 && opts.preview)
+        std::cout << "Preview: " << 100.0 * sampledSum / (double)frameCount << "% of particles drawn on average, "
+                  << preview.count() << " of " << preview.size() << " at exit" << std::endl;
+    if (renderedFrames > 0)
+        std::cout << "Rendered " << renderedFrames << " PNG frames to " << opts.render << ", mean "
+                  << renderMsSum / (double)renderedFrames << " ms each" << std::endl;
+
+    if (checkpointWriter) {
+        checkpointWriter->flush(); // free both buffers so the final snapshot cannot be dropped
+        saveCheckpoint();
+        checkpointWriter->flush(); // and have it on disk before exit
+    }
+    if (seriesWriter)
+        seriesWriter->flush();
+    recorder.close();
+    live.close();
+    streamOut.close();
+    streamView.close();
+    if (!opts.gadgetOut.empty())
+        writeGadget(opts.gadgetOut.c_str(), particles, simTime, opts.gadgetFormat);
+
+    if (headless)
+        return 0;
 
     // 9. Cleanup GL objects
     glDeleteProgram(prog);
-    glDeleteBuffers(1, &vbo);
+    if (lodProg) glDeleteProgram(lodProg);
+    if (tonemapProg) glDeleteProgram(tonemapProg);
+    if (hermiteProg) glDeleteProgram(hermiteProg);
+    if (interpVao) glDeleteVertexArrays(1, &interpVao);
+    if (stateVbo[0]) glDeleteBuffers(2, stateVbo);
+    hdr.destroy();
+    lodStream.destroy();
+    if (lodVao) glDeleteVertexArrays(1, &lodVao);
+    vertexStream.destroy();
+    drawTimer.destroy();
+    glDeleteBuffers(1, &colorVbo);
     glDeleteVertexArrays(1, &vao);
 
     // 10. Terminate GLFW
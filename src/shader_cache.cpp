@@ -0,0 +1,104 @@
+#include "shader_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static constexpr char kProgramMagic[8] = {'N', 'B', 'P', 'R', 'O', 'G', '1', '\0'};
+
+struct ProgramFileHeader {
+    char magic[8];
+    uint32_t format; // GLenum from glGetProgramBinary
+    uint32_t length; // bytes of binary that follow
+};
+
+// FNV-1a, continued across calls
+static uint64_t fnv1a(uint64_t h, const void* data, size_t n) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static uint64_t fnv1a(uint64_t h, const char* s) {
+    if (!s) s = "";
+    return fnv1a(h, s, std::strlen(s) + 1); // the terminator separates the fields
+}
+
+static std::filesystem::path cacheFile(const std::string& dir, uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return std::filesystem::path(dir) / name;
+}
+
+bool programBinarySupported() {
+    if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary) return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+uint64_t programCacheKey(const std::string& vertexSource, const std::string& fragmentSource) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = fnv1a(h, vertexSource.c_str());
+    h = fnv1a(h, fragmentSource.c_str());
+    h = fnv1a(h, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    h = fnv1a(h, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    h = fnv1a(h, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    return h;
+}
+
+bool loadCachedProgram(const std::string& dir, uint64_t key, GLuint prog) {
+    const std::filesystem::path path = cacheFile(dir, key);
+    std::error_code ec;
+    const uintmax_t fileBytes = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    ProgramFileHeader h;
+    if (!f.read(reinterpret_cast<char*>(&h), sizeof(h)) || std::memcmp(h.magic, kProgramMagic, sizeof(h.magic)) != 0)
+        return false;
+    if (fileBytes != sizeof(h) + (uintmax_t)h.length) return false; // truncated or garbage: a miss, not a huge allocation
+    std::vector<char> binary(h.length);
+    if (!f.read(binary.data(), (std::streamsize)binary.size())) return false;
+    glProgramBinary(prog, (GLenum)h.format, binary.data(), (GLsizei)binary.size());
+    GLint ok = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    return ok != 0; // rejected (e.g. a driver change the strings did not show): relink from source
+}
+
+void storeCachedProgram(const std::string& dir, uint64_t key, GLuint prog) {
+    GLint length = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<char> binary((size_t)length);
+    GLenum format = 0;
+    glGetProgramBinary(prog, length, &length, &format, binary.data());
+    if (length <= 0) return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    const std::filesystem::path path = cacheFile(dir, key);
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        ProgramFileHeader h;
+        std::memcpy(h.magic, kProgramMagic, sizeof(h.magic));
+        h.format = (uint32_t)format;
+        h.length = (uint32_t)length;
+        f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        f.write(binary.data(), length);
+        if (!f) {
+            std::cerr << "Cannot write shader cache file " << tmp.string() << std::endl;
+            return;
+        }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) std::cerr << "Cannot store shader cache file " << path.string() << ": " << ec.message() << std::endl;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries (glGetProgramBinary), so later
+// launches skip compiling and linking. The key hashes the shader sources
+// together with the GL vendor, renderer and version strings: an edited
+// shader or a driver update misses, and the program is built and stored
+// again. A binary the driver rejects counts as a miss.
+//
+// Files are DIR/<key>.bin: magic, binary format, length, then the binary.
+// They are written to a temporary name and renamed, so a concurrent launch
+// never reads a partial file.
+
+bool programBinarySupported(); // GL 4.1 or ARB_get_program_binary, with at least one format
+
+uint64_t programCacheKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+// prog: created but not linked. True if it is now linked from the cache.
+bool loadCachedProgram(const std::string& dir, uint64_t key, GLuint prog);
+
+// prog: linked, with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set before linking
+void storeCachedProgram(const std::string& dir, uint64_t key, GLuint prog);
@@ -0,0 +1,263 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "columns assume tightly packed vec3");
+
+static uint64_t alignUp(uint64_t v) {
+    return (v + kSnapshotAlign - 1) & ~(kSnapshotAlign - 1);
+}
+
+static void setField(SnapshotField& f, const char* name, uint32_t components, uint64_t offset, uint64_t count) {
+    std::memset(&f, 0, sizeof(f));
+    std::strncpy(f.name, name, sizeof(f.name) - 1);
+    f.type = kFieldFloat32;
+    f.components = components;
+    f.offset = offset;
+    f.bytes = count * components * sizeof(float);
+}
+
+SnapshotHeader snapshotLayout(uint64_t count, const SnapshotMeta& meta) {
+    SnapshotHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, kSnapshotMagic, sizeof(h.magic));
+    h.version = kSnapshotVersion;
+    h.fieldCount = 4;
+    h.count = count;
+    h.time = meta.time;
+    h.step = meta.step;
+    h.seed = meta.seed;
+    h.integrator = meta.integrator;
+    h.massive = meta.massive;
+
+    uint64_t offset = kSnapshotAlign;
+    const char* names[4] = {"pos", "vel", "color", "mass"};
+    const uint32_t comps[4] = {3, 3, 3, 1};
+    for (uint32_t i = 0; i < 4; ++i) {
+        setField(h.fields[i], names[i], comps[i], offset, count);
+        offset = alignUp(offset + h.fields[i].bytes);
+    }
+    return h;
+}
+
+// Particles per staging chunk are a multiple of 1024, so a chunk of any column
+// (1 or 3 floats per particle) is a whole number of 4096-byte pages
+static size_t chunkParticles(size_t chunkBytes, uint32_t components) {
+    size_t per = chunkBytes / (components * sizeof(float));
+    per -= per % 1024;
+    return per < 1024 ? 1024 : per;
+}
+
+// Transpose one column of particles [c0, c0 + nc) into `out`; returns floats written
+static size_t gatherColumn(const Particle* pts, size_t c0, size_t nc, int field, float* out) {
+    size_t k = 0;
+    for (size_t i = c0; i < c0 + nc; ++i) {
+        const Particle& p = pts[i];
+        switch (field) {
+            case 0: out[k++] = p.pos.x;   out[k++] = p.pos.y;   out[k++] = p.pos.z;   break;
+            case 1: out[k++] = p.vel.x;   out[k++] = p.vel.y;   out[k++] = p.vel.z;   break;
+            case 2: out[k++] = p.color.r; out[k++] = p.color.g; out[k++] = p.color.b; break;
+            default: out[k++] = p.mass; break;
+        }
+    }
+    return k;
+}
+
+// Inverse of gatherColumn for a column identified by name slot (0 pos, 1 vel, 2 color, 3 mass)
+static void scatterColumn(const float* in, size_t c0, size_t nc, int slot, Particle* pts) {
+    for (size_t i = c0; i < c0 + nc; ++i, in += (slot == 3 ? 1 : 3)) {
+        Particle& p = pts[i];
+        switch (slot) {
+            case 0: p.pos = glm::vec3(in[0], in[1], in[2]); break;
+            case 1: p.vel = glm::vec3(in[0], in[1], in[2]); break;
+            case 2: p.color = glm::vec3(in[0], in[1], in[2]); break;
+            default: p.mass = in[0]; break;
+        }
+    }
+}
+
+static int columnSlot(const SnapshotField& f) {
+    if (std::strcmp(f.name, "pos") == 0 && f.components == 3) return 0;
+    if (std::strcmp(f.name, "vel") == 0 && f.components == 3) return 1;
+    if (std::strcmp(f.name, "color") == 0 && f.components == 3) return 2;
+    if (std::strcmp(f.name, "mass") == 0 && f.components == 1) return 3;
+    return -1;
+}
+
+static size_t stagingBytes(const SnapshotIOOptions& options) {
+    return std::max<size_t>(options.chunkBytes, 1024 * 3 * sizeof(float));
+}
+
+bool writeSnapshot(const char* path, const Particle* pts, size_t count, const SnapshotMeta& meta,
+                   const SnapshotIOOptions& options) {
+    const std::string tmp = std::string(path) + ".tmp";
+    std::unique_ptr<ChunkQueue> io = makeChunkQueue(options.backend, stagingBytes(options), options.queueDepth);
+    bool ok = io->open(tmp.c_str(), true, options.directIO);
+
+    // Staging buffers: page aligned, whole pages per write, zero padding at column ends
+    SnapshotHeader h = snapshotLayout(count, meta);
+    IOChunk* c = ok ? io->acquire() : nullptr;
+    if (c) {
+        std::memcpy(c->buf.data, &h, sizeof(h));
+        std::memset(c->buf.data + sizeof(h), 0, kSnapshotAlign - sizeof(h));
+        c->bytes = kSnapshotAlign;
+        c->offset = 0;
+        ok = io->write(c);
+    }
+
+    for (uint32_t f = 0; ok && f < h.fieldCount; ++f) {
+        const SnapshotField& field = h.fields[f];
+        const size_t per = chunkParticles(stagingBytes(options), field.components);
+        uint64_t offset = field.offset;
+        for (size_t c0 = 0; ok && c0 < count; c0 += per) {
+            if (!(c = io->acquire())) { ok = false; break; }
+            size_t nc = std::min(per, count - c0);
+            size_t bytes = gatherColumn(pts, c0, nc, (int)f, reinterpret_cast<float*>(c->buf.data)) * sizeof(float);
+            c->bytes = (size_t)alignUp(bytes);
+            c->offset = offset;
+            std::memset(c->buf.data + bytes, 0, c->bytes - bytes);
+            ok = io->write(c);
+            offset += c->bytes;
+        }
+    }
+    ok = io->finish() && ok;
+
+    std::error_code ec;
+    if (ok) std::filesystem::rename(tmp, path, ec);
+    if (!ok || ec) {
+        std::cerr << "Checkpoint write failed: " << path << std::endl;
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool writeSnapshot(const char* path, const std::vector<Particle>& pts, const SnapshotMeta& meta,
+                   const SnapshotIOOptions& options) {
+    return writeSnapshot(path, pts.data(), pts.size(), meta, options);
+}
+
+// Magic, version and column bounds against the file size
+static bool checkHeader(const SnapshotHeader* h, uint64_t fileSize, const char* path) {
+    if (fileSize < kSnapshotAlign || std::memcmp(h->magic, kSnapshotMagic, sizeof(h->magic)) != 0) {
+        std::cerr << "Not a snapshot file: " << path << std::endl;
+        return false;
+    }
+    if (h->version != kSnapshotVersion || h->fieldCount > kSnapshotMaxFields) {
+        std::cerr << "Unsupported snapshot version " << h->version << ": " << path << std::endl;
+        return false;
+    }
+    bool hasPos = false, hasVel = false;
+    for (uint32_t i = 0; i < h->fieldCount; ++i) {
+        const SnapshotField& f = h->fields[i];
+        if (f.type != kFieldFloat32 || f.offset % kSnapshotAlign != 0 ||
+            f.offset + f.bytes > fileSize || f.bytes != h->count * f.components * sizeof(float)) {
+            std::cerr << "Corrupt snapshot field '" << f.name << "': " << path << std::endl;
+            return false;
+        }
+        hasPos = hasPos || columnSlot(f) == 0;
+        hasVel = hasVel || columnSlot(f) == 1;
+    }
+    if (!hasPos || !hasVel) {
+        std::cerr << "Snapshot lacks pos/vel: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool openSnapshot(const char* path, Snapshot& snap) {
+    snap = Snapshot{};
+    if (!snap.file.open(path)) return false;
+
+    const SnapshotHeader* h = reinterpret_cast<const SnapshotHeader*>(snap.file.data);
+    if (!checkHeader(h, snap.file.size, path)) return false;
+
+    // Point the known columns into the mapping
+    for (uint32_t i = 0; i < h->fieldCount; ++i) {
+        const void* col = snap.file.data + h->fields[i].offset;
+        switch (columnSlot(h->fields[i])) {
+            case 0: snap.pos = static_cast<const glm::vec3*>(col); break;
+            case 1: snap.vel = static_cast<const glm::vec3*>(col); break;
+            case 2: snap.color = static_cast<const glm::vec3*>(col); break;
+            case 3: snap.mass = static_cast<const float*>(col); break;
+            default: break;
+        }
+    }
+    snap.header = h;
+    return true;
+}
+
+void snapshotToParticles(const Snapshot& snap, std::vector<Particle>& pts) {
+    const size_t n = snap.count();
+    pts.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        pts[i].pos = snap.pos[i];
+        pts[i].vel = snap.vel[i];
+        pts[i].color = snap.color ? snap.color[i] : glm::vec3(1.0f);
+        pts[i].mass = snap.mass ? snap.mass[i] : 1.0f;
+    }
+}
+
+bool readSnapshot(const char* path, std::vector<Particle>& pts, SnapshotHeader& header,
+                  const SnapshotIOOptions& options) {
+    std::error_code ec;
+    const uint64_t fileSize = std::filesystem::file_size(path, ec);
+    if (ec) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+    std::unique_ptr<ChunkQueue> io = makeChunkQueue(options.backend, stagingBytes(options), options.queueDepth);
+    if (!io->open(path, false, options.directIO)) return false;
+
+    // Header page first; it decides where the columns are
+    io->onRead = [&](const IOChunk& c) { std::memcpy(&header, c.buf.data, sizeof(header)); };
+    IOChunk* c = io->acquire();
+    bool ok = c != nullptr;
+    if (ok) {
+        c->bytes = kSnapshotAlign;
+        c->offset = 0;
+        ok = io->read(c) && io->drain();
+    }
+    if (!ok || !checkHeader(&header, fileSize, path)) {
+        io->finish();
+        return false;
+    }
+
+    const size_t count = (size_t)header.count;
+    pts.assign(count, Particle{glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(0.0f), 1.0f});
+
+    // Completions arrive in any order: recover the column and particle range from the offset
+    io->onRead = [&](const IOChunk& done) {
+        for (uint32_t i = 0; i < header.fieldCount; ++i) {
+            const SnapshotField& f = header.fields[i];
+            if (done.offset < f.offset || done.offset >= f.offset + f.bytes) continue;
+            const size_t per = chunkParticles(stagingBytes(options), f.components);
+            const size_t c0 = (size_t)(done.offset - f.offset) / (f.components * sizeof(float));
+            scatterColumn(reinterpret_cast<const float*>(done.buf.data), c0, std::min(per, count - c0),
+                          columnSlot(f), pts.data());
+            return;
+        }
+    };
+
+    for (uint32_t i = 0; ok && i < header.fieldCount; ++i) {
+        const SnapshotField& f = header.fields[i];
+        if (columnSlot(f) < 0) continue;
+        const size_t per = chunkParticles(stagingBytes(options), f.components);
+        for (size_t c0 = 0; ok && c0 < count; c0 += per) {
+            if (!(c = io->acquire())) { ok = false; break; }
+            size_t nc = std::min(per, count - c0);
+            c->offset = f.offset + (uint64_t)c0 * f.components * sizeof(float);
+            c->bytes = (size_t)std::min<uint64_t>(alignUp(nc * f.components * sizeof(float)), fileSize - c->offset);
+            ok = io->read(c);
+        }
+    }
+    ok = io->finish() && ok;
+    if (!ok) std::cerr << "Checkpoint read failed: " << path << std::endl;
+    return ok;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chunk_io.h"
+#include "mapped_file.h"
+#include "particle.h"
+
+// Binary checkpoint format (.nbs), little-endian:
+//
+//   [0, 4096)        SnapshotHeader (magic, version, counts, field table)
+//   field 0          pos   : count x float3
+//   field 1          vel   : count x float3
+//   field 2          color : count x float3
+//   field 3          mass  : count x float
+//
+// Each column starts on a 4096-byte boundary.
+//
+// Columns are stored exactly as they are used in memory, so a mapped file can
+// be read in place (e.g. pos straight into a VBO) without any parsing.
+// Files are written to "<path>.tmp" and renamed over <path> once complete, so
+// a crash mid-write never leaves a truncated checkpoint behind.
+
+static constexpr char kSnapshotMagic[8] = {'N', 'B', 'S', 'N', 'A', 'P', '\0', '\0'};
+static constexpr uint32_t kSnapshotVersion = 1;
+static constexpr uint64_t kSnapshotAlign = 4096;
+static constexpr uint32_t kSnapshotMaxFields = 8;
+
+enum SnapshotFieldType : uint32_t {
+    kFieldFloat32 = 1,
+};
+
+struct SnapshotField {
+    char     name[16];    // "pos", "vel", "color", "mass"
+    uint32_t type;        // SnapshotFieldType
+    uint32_t components;  // floats per particle
+    uint64_t offset;      // byte offset from file start (aligned)
+    uint64_t bytes;       // byte length of the column
+};
+
+struct SnapshotHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t fieldCount;
+    uint64_t count;       // particles
+    double   time;        // simulation time
+    uint64_t step;        // steps taken
+    uint64_t seed;        // initial-condition seed
+    uint32_t integrator;  // IntegratorKind the run used
+    uint32_t massive;     // tracer mode: massive sources at the front (0 = not recorded)
+    SnapshotField fields[kSnapshotMaxFields];
+};
+static_assert(sizeof(SnapshotHeader) <= kSnapshotAlign, "header must fit in its page");
+
+// Run metadata stored alongside the particles
+struct SnapshotMeta {
+    double   time = 0.0;
+    uint64_t step = 0;
+    uint64_t seed = 0;
+    uint32_t integrator = 0;
+    uint32_t massive = 0;
+};
+
+// Header + column layout for `count` particles
+SnapshotHeader snapshotLayout(uint64_t count, const SnapshotMeta& meta);
+
+// How checkpoint bytes move between memory and disk
+struct SnapshotIOOptions {
+    bool directIO = false;              // bypass the page cache (O_DIRECT) where supported
+    size_t chunkBytes = 8u << 20;       // staging buffer size: one transfer per chunk
+    IOBackend backend = IOBackend::Sync;
+    unsigned queueDepth = 8;            // io_uring: chunks in flight (and staging buffers)
+};
+
+// Write a checkpoint atomically (temp file + rename). Columns are transposed
+// into page-aligned staging buffers and written in large whole-page chunks;
+// with the io_uring backend several chunks are in flight while the next one
+// is being transposed. Returns false on I/O failure.
+bool writeSnapshot(const char* path, const Particle* pts, size_t count, const SnapshotMeta& meta,
+                   const SnapshotIOOptions& options = SnapshotIOOptions{});
+bool writeSnapshot(const char* path, const std::vector<Particle>& pts, const SnapshotMeta& meta,
+                   const SnapshotIOOptions& options = SnapshotIOOptions{});
+
+// A mapped snapshot: column pointers point straight into the file mapping
+struct Snapshot {
+    MappedFile file;
+    const SnapshotHeader* header = nullptr;
+    const glm::vec3* pos = nullptr;
+    const glm::vec3* vel = nullptr;
+    const glm::vec3* color = nullptr;
+    const float* mass = nullptr;
+
+    size_t count() const { return header ? (size_t)header->count : 0; }
+};
+
+// Map and validate a checkpoint. Returns false (and prints why) on a bad file.
+bool openSnapshot(const char* path, Snapshot& snap);
+
+// Rebuild the simulation's particle array from a mapped snapshot
+void snapshotToParticles(const Snapshot& snap, std::vector<Particle>& pts);
+
+// Read a checkpoint straight into a particle array with explicit chunked
+// reads instead of page faults on a mapping (queue-depth reads in flight with
+// the io_uring backend). `header` receives the validated header.
+bool readSnapshot(const char* path, std::vector<Particle>& pts, SnapshotHeader& header,
+                  const SnapshotIOOptions& options = SnapshotIOOptions{});
@@ -0,0 +1,512 @@
+#include "snapshot_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "chunk_io.h"
+#include "mapped_file.h"
+#include "parallel.h"
+
+static constexpr unsigned kRiceGroup = 128;  // values sharing one Rice parameter
+static constexpr unsigned kRiceEscape = 24;  // unary prefix length that flags a raw 64-bit value
+
+// ---- Bit-level I/O (LSB first) ----
+
+struct BitWriter {
+    std::vector<uint8_t>& out;
+    uint64_t acc = 0;
+    unsigned n = 0; // pending bits in acc, always < 8 between calls
+
+    explicit BitWriter(std::vector<uint8_t>& o) : out(o) {}
+
+    void put(uint64_t v, unsigned bits) { // bits <= 32
+        if (bits == 0) return;
+        acc |= (v & ((uint64_t(1) << bits) - 1)) << n;
+        n += bits;
+        while (n >= 8) {
+            out.push_back((uint8_t)acc);
+            acc >>= 8;
+            n -= 8;
+        }
+    }
+    void putWide(uint64_t v, unsigned bits) { // bits <= 64
+        if (bits > 32) {
+            put(v, 32);
+            put(v >> 32, bits - 32);
+        } else {
+            put(v, bits);
+        }
+    }
+    void flush() {
+        if (n > 0) out.push_back((uint8_t)acc);
+        acc = 0;
+        n = 0;
+    }
+};
+
+struct BitReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    uint64_t acc = 0;
+    unsigned n = 0;
+    bool overrun = false;
+
+    BitReader(const uint8_t* b, const uint8_t* e) : p(b), end(e) {}
+
+    uint64_t get(unsigned bits) { // bits <= 32
+        if (bits == 0) return 0;
+        while (n < bits) {
+            uint64_t byte = 0;
+            if (p < end) byte = *p++;
+            else overrun = true;
+            acc |= byte << n;
+            n += 8;
+        }
+        uint64_t v = acc & ((uint64_t(1) << bits) - 1);
+        acc >>= bits;
+        n -= bits;
+        return v;
+    }
+    uint64_t getWide(unsigned bits) {
+        if (bits > 32) {
+            uint64_t lo = get(32);
+            return lo | (get(bits - 32) << 32);
+        }
+        return get(bits);
+    }
+};
+
+// ---- Rice coding of unsigned residuals ----
+
+static unsigned riceParameter(const uint64_t* v, size_t n) {
+    double mean = 0.0;
+    for (size_t i = 0; i < n; ++i) mean += (double)v[i];
+    mean /= (double)(n ? n : 1);
+    if (mean < 1.0) return 0;
+    int k = (int)std::floor(std::log2(mean * 0.6931471805599453));
+    return (unsigned)std::clamp(k, 0, 56);
+}
+
+static void riceEncode(BitWriter& bw, const uint64_t* v, size_t n) {
+    for (size_t g = 0; g < n; g += kRiceGroup) {
+        const size_t m = std::min<size_t>(kRiceGroup, n - g);
+        const unsigned k = riceParameter(v + g, m);
+        bw.put(k, 6);
+        for (size_t i = g; i < g + m; ++i) {
+            uint64_t q = v[i] >> k;
+            if (q < kRiceEscape) {
+                bw.put((uint64_t(1) << q) - 1, (unsigned)q);
+                bw.put(0, 1);
+                bw.putWide(v[i], k);
+            } else {
+                bw.put((uint64_t(1) << kRiceEscape) - 1, kRiceEscape);
+                bw.putWide(v[i], 64);
+            }
+        }
+    }
+}
+
+static void riceDecode(BitReader& br, uint64_t* v, size_t n) {
+    for (size_t g = 0; g < n; g += kRiceGroup) {
+        const size_t m = std::min<size_t>(kRiceGroup, n - g);
+        const unsigned k = (unsigned)br.get(6);
+        for (size_t i = g; i < g + m; ++i) {
+            unsigned q = 0;
+            while (q < kRiceEscape && br.get(1)) ++q;
+            v[i] = q < kRiceEscape ? (uint64_t(q) << k) | br.getWide(k) : br.getWide(64);
+            if (br.overrun) return;
+        }
+    }
+}
+
+static uint64_t zigzag(int64_t d) { return ((uint64_t)d << 1) ^ (uint64_t)(d >> 63); }
+static int64_t unzigzag(uint64_t u) { return (int64_t)(u >> 1) ^ -(int64_t)(u & 1); }
+
+// ---- Quantization ----
+
+struct Quantizer {
+    double origin[3];
+    double step;
+    int64_t maxIndex;
+};
+
+// Grid for one vec3 attribute such that the decoded float is within `error`
+// of the original: half a step of quantization plus half an ulp of rounding
+// back to float, for the largest magnitude present
+static bool makeQuantizer(const Particle* pts, size_t count, size_t member, double error, Quantizer& q,
+                          const char* what) {
+    double lo[3] = {0.0, 0.0, 0.0}, hi[3] = {0.0, 0.0, 0.0};
+    double maxAbs = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        const float* v = reinterpret_cast<const float*>(reinterpret_cast<const char*>(&pts[i]) + member);
+        for (int a = 0; a < 3; ++a) {
+            if (i == 0 || v[a] < lo[a]) lo[a] = v[a];
+            if (i == 0 || v[a] > hi[a]) hi[a] = v[a];
+            maxAbs = std::max(maxAbs, (double)std::fabs(v[a]));
+        }
+    }
+    const double ulp = maxAbs * std::ldexp(1.0, -23);
+    q.step = 2.0 * (error - ulp);
+    if (!(q.step > 0.0)) {
+        std::cerr << "Compression error bound " << error << " is below float precision for " << what << std::endl;
+        return false;
+    }
+    double extent = 0.0;
+    for (int a = 0; a < 3; ++a) {
+        q.origin[a] = lo[a];
+        extent = std::max(extent, hi[a] - lo[a]);
+    }
+    if (extent / q.step > std::ldexp(1.0, 60)) {
+        std::cerr << "Compression error bound " << error << " too fine for the range of " << what << std::endl;
+        return false;
+    }
+    q.maxIndex = (int64_t)std::llround(extent / q.step);
+    return true;
+}
+
+static int64_t quantize(const Quantizer& q, int axis, float v) {
+    return (int64_t)std::llround(((double)v - q.origin[axis]) / q.step);
+}
+
+static float dequantize(const CompressedHeader& h, bool vel, int axis, int64_t i) {
+    return vel ? (float)(h.velOrigin[axis] + (double)i * h.velStep)
+               : (float)(h.posOrigin[axis] + (double)i * h.posStep);
+}
+
+// Spread the low 21 bits of x so there are two zero bits between each
+static uint64_t part1by2(uint64_t x) {
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffull;
+    x = (x | x << 16) & 0x1f0000ff0000ffull;
+    x = (x | x << 8) & 0x100f00f00f00f00full;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+    x = (x | x << 2) & 0x1249249249249249ull;
+    return x;
+}
+
+struct KeyIndex {
+    uint64_t key;
+    uint64_t index;
+    bool operator<(const KeyIndex& o) const { return key < o.key || (key == o.key && index < o.index); }
+};
+
+// Sort in per-thread slices, then merge the sorted runs pairwise
+static void parallelSort(std::vector<KeyIndex>& v) {
+    std::vector<size_t> starts;
+    std::mutex m;
+    parallelFor(v.size(), 1u << 16, [&](size_t b, size_t e) {
+        std::sort(v.begin() + b, v.begin() + e);
+        std::lock_guard<std::mutex> lock(m);
+        starts.push_back(b);
+    });
+    std::sort(starts.begin(), starts.end());
+    starts.push_back(v.size());
+    while (starts.size() > 2) {
+        std::vector<size_t> merged;
+        for (size_t i = 0; i + 2 < starts.size(); i += 2) {
+            std::inplace_merge(v.begin() + starts[i], v.begin() + starts[i + 1], v.begin() + starts[i + 2]);
+            merged.push_back(starts[i]);
+        }
+        if (starts.size() % 2 == 0) merged.push_back(starts[starts.size() - 2]); // odd run out
+        merged.push_back(v.size());
+        starts.swap(merged);
+    }
+}
+
+// ---- Block coding ----
+
+// Code particles `idx[0..n)` (global indices, in coding order). With keepOrder
+// the block covers [first, first + n) and each particle's offset is stored.
+static void encodeBlock(const Particle* pts, const KeyIndex* idx, size_t n, uint64_t first, bool keepOrder,
+                        const Quantizer& qp, const Quantizer& qv, std::vector<uint8_t>& out) {
+    BitWriter bw(out);
+    std::vector<uint64_t> vals(n);
+
+    if (keepOrder) {
+        for (size_t i = 0; i < n; ++i) vals[i] = idx[i].index - first;
+        riceEncode(bw, vals.data(), n);
+    }
+    for (int attr = 0; attr < 2; ++attr) {
+        const Quantizer& q = attr == 0 ? qp : qv;
+        for (int a = 0; a < 3; ++a) {
+            int64_t prev = 0;
+            for (size_t i = 0; i < n; ++i) {
+                const Particle& p = pts[idx[i].index];
+                int64_t cur = quantize(q, a, attr == 0 ? p.pos[a] : p.vel[a]);
+                vals[i] = zigzag(cur - prev);
+                prev = cur;
+            }
+            riceEncode(bw, vals.data(), n);
+        }
+    }
+    for (int a = 0; a < 3; ++a) {
+        int64_t prev = 0;
+        for (size_t i = 0; i < n; ++i) {
+            float c = std::clamp(pts[idx[i].index].color[a], 0.0f, 1.0f);
+            int64_t cur = (int64_t)std::lround(c * 255.0f);
+            vals[i] = zigzag(cur - prev);
+            prev = cur;
+        }
+        riceEncode(bw, vals.data(), n);
+    }
+    uint32_t prevBits = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, &pts[idx[i].index].mass, sizeof(bits));
+        vals[i] = bits ^ prevBits; // equal masses code as zeros
+        prevBits = bits;
+    }
+    riceEncode(bw, vals.data(), n);
+    bw.flush();
+}
+
+static bool decodeBlock(const CompressedHeader& h, const CompressedBlock& blk, const uint8_t* data, Particle* pts) {
+    const size_t n = (size_t)blk.count;
+    BitReader br(data, data + blk.bytes);
+    std::vector<uint64_t> vals(n);
+    std::vector<uint64_t> slot(n);
+
+    if (h.flags & kCompressedKeepOrder) {
+        // Slots must be a permutation of the block: a repeat would leave another particle unset
+        riceDecode(br, slot.data(), n);
+        std::vector<bool> seen(n, false);
+        for (size_t i = 0; i < n; ++i) {
+            if (slot[i] >= n || seen[slot[i]]) return false;
+            seen[slot[i]] = true;
+        }
+    } else {
+        for (size_t i = 0; i < n; ++i) slot[i] = i;
+    }
+    Particle* base = pts + blk.first;
+    for (int attr = 0; attr < 2; ++attr) {
+        for (int a = 0; a < 3; ++a) {
+            riceDecode(br, vals.data(), n);
+            int64_t cur = 0;
+            for (size_t i = 0; i < n; ++i) {
+                cur += unzigzag(vals[i]);
+                float v = dequantize(h, attr == 1, a, cur);
+                if (attr == 0) base[slot[i]].pos[a] = v;
+                else base[slot[i]].vel[a] = v;
+            }
+        }
+    }
+    for (int a = 0; a < 3; ++a) {
+        riceDecode(br, vals.data(), n);
+        int64_t cur = 0;
+        for (size_t i = 0; i < n; ++i) {
+            cur += unzigzag(vals[i]);
+            base[slot[i]].color[a] = (float)cur / 255.0f;
+        }
+    }
+    riceDecode(br, vals.data(), n);
+    uint32_t bits = 0;
+    for (size_t i = 0; i < n; ++i) {
+        bits ^= (uint32_t)vals[i];
+        std::memcpy(&base[slot[i]].mass, &bits, sizeof(bits));
+    }
+    return !br.overrun;
+}
+
+// ---- File I/O ----
+
+// Appends bytes into page-aligned chunks and hands full ones to the queue
+struct ChunkStream {
+    ChunkQueue& io;
+    IOChunk* cur = nullptr;
+    uint64_t offset = 0;  // file offset of cur
+    bool ok = true;
+
+    explicit ChunkStream(ChunkQueue& q) : io(q) {}
+
+    void put(const void* src, size_t bytes) {
+        const uint8_t* p = static_cast<const uint8_t*>(src);
+        while (ok && bytes > 0) {
+            if (!cur) {
+                if (!(cur = io.acquire())) { ok = false; return; }
+                cur->bytes = 0;
+                cur->offset = offset;
+            }
+            size_t n = std::min(bytes, cur->buf.size - cur->bytes);
+            std::memcpy(cur->buf.data + cur->bytes, p, n);
+            cur->bytes += n;
+            p += n;
+            bytes -= n;
+            if (cur->bytes == cur->buf.size) submit();
+        }
+    }
+    // Zero-pad the tail to a whole page and write it
+    void finish() {
+        if (!ok || !cur) return;
+        size_t padded = (cur->bytes + kSnapshotAlign - 1) & ~(size_t)(kSnapshotAlign - 1);
+        std::memset(cur->buf.data + cur->bytes, 0, padded - cur->bytes);
+        cur->bytes = padded;
+        submit();
+    }
+
+private:
+    void submit() {
+        offset += cur->bytes;
+        ok = io.write(cur);
+        cur = nullptr;
+    }
+};
+
+bool writeCompressedSnapshot(const char* path, const Particle* pts, size_t count, const SnapshotMeta& meta,
+                             const CompressOptions& codec, const SnapshotIOOptions& ioOptions,
+                             std::vector<uint64_t>* order) {
+    CompressedHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, kCompressedMagic, sizeof(h.magic));
+    h.version = kCompressedVersion;
+    h.flags = codec.keepOrder ? kCompressedKeepOrder : 0;
+    h.count = count;
+    h.time = meta.time;
+    h.step = meta.step;
+    h.seed = meta.seed;
+    h.integrator = meta.integrator;
+    h.massive = meta.massive;
+    h.blockParticles = std::max<uint32_t>(codec.blockParticles, 1024);
+    h.blockCount = (count + h.blockParticles - 1) / h.blockParticles;
+    h.posError = codec.posError;
+    h.velError = codec.velError;
+
+    Quantizer qp, qv;
+    if (!makeQuantizer(pts, count, offsetof(Particle, pos), codec.posError, qp, "positions") ||
+        !makeQuantizer(pts, count, offsetof(Particle, vel), codec.velError, qv, "velocities"))
+        return false;
+    std::copy(qp.origin, qp.origin + 3, h.posOrigin);
+    std::copy(qv.origin, qv.origin + 3, h.velOrigin);
+    h.posStep = qp.step;
+    h.velStep = qv.step;
+
+    // Morton keys from the top 21 bits of each quantized coordinate
+    unsigned shift = 0;
+    while ((qp.maxIndex >> shift) >= (int64_t(1) << 21)) ++shift;
+    std::vector<KeyIndex> keys(count);
+    parallelFor(count, 1u << 16, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            uint64_t k = 0;
+            for (int a = 0; a < 3; ++a) k |= part1by2((uint64_t)quantize(qp, a, pts[i].pos[a]) >> shift) << a;
+            keys[i] = KeyIndex{k, i};
+        }
+    });
+    if (!codec.keepOrder) parallelSort(keys);
+
+    // Compress blocks independently
+    std::vector<std::vector<uint8_t>> blocks(h.blockCount);
+    parallelFor(h.blockCount, 1, [&](size_t b, size_t e) {
+        for (size_t blk = b; blk < e; ++blk) {
+            const size_t first = blk * h.blockParticles;
+            const size_t n = std::min<size_t>(h.blockParticles, count - first);
+            KeyIndex* k = keys.data() + first;
+            if (codec.keepOrder) std::sort(k, k + n);
+            blocks[blk].reserve(n * 8);
+            encodeBlock(pts, k, n, first, codec.keepOrder, qp, qv, blocks[blk]);
+        }
+    });
+    if (order) {
+        order->resize(count);
+        for (size_t i = 0; i < count; ++i) (*order)[i] = codec.keepOrder ? i : keys[i].index;
+    }
+
+    std::vector<CompressedBlock> table(h.blockCount);
+    uint64_t offset = kSnapshotAlign + h.blockCount * sizeof(CompressedBlock);
+    for (size_t b = 0; b < h.blockCount; ++b) {
+        table[b].offset = offset;
+        table[b].bytes = blocks[b].size();
+        table[b].first = b * h.blockParticles;
+        table[b].count = std::min<uint64_t>(h.blockParticles, count - table[b].first);
+        offset += table[b].bytes;
+    }
+
+    const std::string tmp = std::string(path) + ".tmp";
+    std::unique_ptr<ChunkQueue> io = makeChunkQueue(ioOptions.backend, std::max<size_t>(ioOptions.chunkBytes, kSnapshotAlign),
+                                                    ioOptions.queueDepth);
+    bool ok = io->open(tmp.c_str(), true, ioOptions.directIO);
+    if (ok) {
+        ChunkStream out(*io);
+        std::vector<uint8_t> page(kSnapshotAlign, 0);
+        std::memcpy(page.data(), &h, sizeof(h));
+        out.put(page.data(), page.size());
+        out.put(table.data(), table.size() * sizeof(CompressedBlock));
+        for (const auto& b : blocks) out.put(b.data(), b.size());
+        out.finish();
+        ok = out.ok;
+    }
+    ok = io->finish() && ok;
+
+    std::error_code ec;
+    if (ok) std::filesystem::rename(tmp, path, ec);
+    if (!ok || ec) {
+        std::cerr << "Checkpoint write failed: " << path << std::endl;
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool isCompressedSnapshot(const char* path) {
+    char magic[sizeof(kCompressedMagic)] = {};
+    std::ifstream in(path, std::ios::binary);
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, kCompressedMagic, sizeof(magic)) == 0;
+}
+
+bool readCompressedSnapshot(const char* path, std::vector<Particle>& pts, CompressedHeader& header) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    const CompressedHeader* h = reinterpret_cast<const CompressedHeader*>(file.data);
+    if (file.size < kSnapshotAlign || std::memcmp(h->magic, kCompressedMagic, sizeof(h->magic)) != 0) {
+        std::cerr << "Not a compressed snapshot: " << path << std::endl;
+        return false;
+    }
+    if (h->version != kCompressedVersion) {
+        std::cerr << "Unsupported compressed snapshot version " << h->version << ": " << path << std::endl;
+        return false;
+    }
+    const uint64_t tableEnd = kSnapshotAlign + h->blockCount * sizeof(CompressedBlock);
+    if (h->blockCount > h->count || tableEnd > file.size) {
+        std::cerr << "Corrupt compressed snapshot: " << path << std::endl;
+        return false;
+    }
+    // Blocks are decoded in parallel, so their ranges must tile [0, count) exactly:
+    // an overlap would have two threads write the same particles, a gap would leave some unset
+    const CompressedBlock* table = reinterpret_cast<const CompressedBlock*>(file.data + kSnapshotAlign);
+    uint64_t covered = 0;
+    for (uint64_t b = 0; b < h->blockCount; ++b) {
+        const CompressedBlock& blk = table[b];
+        if (blk.offset > file.size || blk.bytes > file.size - blk.offset || blk.first != covered ||
+            blk.count > h->count - covered) {
+            std::cerr << "Corrupt compressed snapshot block " << b << ": " << path << std::endl;
+            return false;
+        }
+        covered += blk.count;
+    }
+    if (covered != h->count) {
+        std::cerr << "Corrupt compressed snapshot: blocks cover " << covered << " of " << h->count
+                  << " particles: " << path << std::endl;
+        return false;
+    }
+
+    header = *h;
+    pts.resize((size_t)h->count);
+    bool ok = true;
+    std::mutex m;
+    parallelFor((size_t)h->blockCount, 1, [&](size_t b, size_t e) {
+        for (size_t blk = b; blk < e; ++blk) {
+            if (decodeBlock(header, table[blk], file.data + table[blk].offset, pts.data())) continue;
+            std::lock_guard<std::mutex> lock(m);
+            ok = false;
+        }
+    });
+    if (!ok) std::cerr << "Corrupt compressed snapshot data: " << path << std::endl;
+    return ok;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "particle.h"
+#include "snapshot.h"
+
+// Error-bounded lossy snapshot format (.nbz), little-endian:
+//
+//   [0, 4096)        CompressedHeader (magic, run metadata, quantizer, block count)
+//   4096             CompressedBlock table
+//   ...              independently coded blocks of up to blockParticles particles
+//
+// Positions and velocities are quantized on uniform grids whose step is
+// chosen so every component is reproduced within the requested absolute
+// error. Particles are coded in Morton order of their quantized position, so
+// neighbours in the stream are neighbours in space and position deltas stay
+// small; velocities are delta-coded along the same order (nearby particles
+// move alike). Colors are stored at 8 bits per channel and masses exactly.
+// Every stream is Rice coded with a parameter picked per 128 values.
+//
+// Blocks are compressed and decompressed in parallel. By default particles
+// come back in Morton order; keepOrder makes each block cover a contiguous
+// range of the original indices and stores the in-block permutation, for
+// runs where index matters (e.g. tracer mode keeps its sources first).
+
+static constexpr char kCompressedMagic[8] = {'N', 'B', 'S', 'Z', 'I', 'P', '\0', '\0'};
+static constexpr uint32_t kCompressedVersion = 1;
+static constexpr uint32_t kCompressedKeepOrder = 1; // CompressedHeader::flags
+
+struct CompressedHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t count;          // particles
+    double   time;
+    uint64_t step;
+    uint64_t seed;
+    uint32_t integrator;
+    uint32_t blockParticles;
+    uint64_t blockCount;
+    double   posOrigin[3];   // grid origin; component = origin + q * posStep
+    double   posStep;
+    double   velOrigin[3];
+    double   velStep;
+    double   posError;       // requested bounds, for reference
+    double   velError;
+    uint32_t massive;        // as SnapshotHeader::massive (0 in files that predate it)
+    uint32_t reserved;
+};
+static_assert(sizeof(CompressedHeader) <= kSnapshotAlign, "header must fit in its page");
+
+struct CompressedBlock {
+    uint64_t offset;  // byte offset from file start
+    uint64_t bytes;
+    uint64_t first;   // first particle index the block decodes to
+    uint64_t count;
+};
+
+struct CompressOptions {
+    double posError = 1e-3;           // max |x' - x| per component, world units
+    double velError = 1e-3;
+    bool keepOrder = false;           // preserve particle indices (costs ~2 bytes/particle)
+    uint32_t blockParticles = 1u << 16;
+};
+
+// Compress and write atomically (temp file + rename) through the same chunked
+// I/O path as writeSnapshot. If `order` is given it receives, for each stored
+// particle, the index it came from (identity when keepOrder is set).
+bool writeCompressedSnapshot(const char* path, const Particle* pts, size_t count, const SnapshotMeta& meta,
+                             const CompressOptions& codec, const SnapshotIOOptions& io = SnapshotIOOptions{},
+                             std::vector<uint64_t>* order = nullptr);
+
+// True if `path` starts with the .nbz magic
+bool isCompressedSnapshot(const char* path);
+
+// Map, validate and decode a compressed snapshot
+bool readCompressedSnapshot(const char* path, std::vector<Particle>& pts, CompressedHeader& header);
@@ -0,0 +1,84 @@
+#include "snapshot_writer.h"
+
+#include <chrono>
+#include <iostream>
+
+AsyncSnapshotWriter::AsyncSnapshotWriter(const SnapshotIOOptions& opts, const CompressOptions* compress,
+                                         const std::string& logLabel)
+    : options(opts), compressed(compress != nullptr), codec(compress ? *compress : CompressOptions{}),
+      label(logLabel), worker([this] { run(); }) {}
+
+AsyncSnapshotWriter::~AsyncSnapshotWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+bool AsyncSnapshotWriter::submit(const std::string& path, const std::vector<Particle>& pts, const SnapshotMeta& meta) {
+    Slot* slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Slot& s : slots)
+            if (s.state == SlotState::Free) { slot = &s; break; }
+        if (!slot) {
+            ++droppedCount;
+            return false;
+        }
+        slot->state = SlotState::Writing; // reserved: the writer skips it until Queued
+    }
+
+    // Copy outside the lock; only this thread touches a reserved slot
+    slot->path = path;
+    slot->pts.assign(pts.begin(), pts.end());
+    slot->meta = meta;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        slot->ticket = nextTicket++;
+        slot->state = SlotState::Queued;
+    }
+    wake.notify_one();
+    return true;
+}
+
+void AsyncSnapshotWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] {
+        return slots[0].state == SlotState::Free && slots[1].state == SlotState::Free;
+    });
+}
+
+void AsyncSnapshotWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        // Oldest queued slot first
+        Slot* next = nullptr;
+        for (Slot& s : slots)
+            if (s.state == SlotState::Queued && (!next || s.ticket < next->ticket)) next = &s;
+
+        if (!next) {
+            if (stopping) return;
+            wake.wait(lock);
+            continue;
+        }
+
+        next->state = SlotState::Writing;
+        lock.unlock();
+
+        auto t0 = std::chrono::steady_clock::now();
+        bool ok = compressed ? writeCompressedSnapshot(next->path.c_str(), next->pts.data(), next->pts.size(),
+                                                       next->meta, codec, options)
+                             : writeSnapshot(next->path.c_str(), next->pts, next->meta, options);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        if (ok && !label.empty())
+            std::cout << label << " written: " << next->path << " (step " << next->meta.step
+                      << ", " << ms << " ms in background)" << std::endl;
+
+        lock.lock();
+        next->state = SlotState::Free;
+        idle.notify_all();
+    }
+}
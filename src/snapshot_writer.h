@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "snapshot.h"
+#include "snapshot_codec.h"
+
+// Background checkpoint writer with two particle buffers.
+//
+// submit() copies the particle array into whichever buffer is free (a single
+// memcpy; capacity is reused so there is no allocation after the first
+// snapshot) and returns immediately. The writer thread transposes and writes
+// that copy with writeSnapshot while stepping continues on the live array.
+// If both buffers are still queued or being written the snapshot is dropped
+// rather than stalling the simulation. With `compress` set the copies are
+// written as error-bounded .nbz files instead (snapshot_codec.h), the block
+// compression also running off the simulation thread. Each finished file is
+// logged as "<label> written: ..." unless the label is empty.
+class AsyncSnapshotWriter {
+public:
+    explicit AsyncSnapshotWriter(const SnapshotIOOptions& options = SnapshotIOOptions{},
+                                 const CompressOptions* compress = nullptr, const std::string& label = "Checkpoint");
+    ~AsyncSnapshotWriter(); // finishes queued snapshots, then stops the thread
+
+    // Queue a snapshot of `pts`. Returns false if it had to be dropped.
+    bool submit(const std::string& path, const std::vector<Particle>& pts, const SnapshotMeta& meta);
+
+    // Block until every queued snapshot is on disk
+    void flush();
+
+    uint64_t dropped() const { return droppedCount; }
+
+private:
+    enum class SlotState { Free, Queued, Writing };
+    struct Slot {
+        SlotState state = SlotState::Free;
+        uint64_t ticket = 0;          // submission order, so files land in sequence
+        std::string path;
+        std::vector<Particle> pts;
+        SnapshotMeta meta;
+    };
+
+    void run();
+
+    SnapshotIOOptions options;
+    bool compressed = false;
+    CompressOptions codec;
+    std::string label; // log prefix for finished files (empty = quiet)
+    Slot slots[2];
+    uint64_t nextTicket = 0;
+    uint64_t droppedCount = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable wake; // writer: work queued / stop
+    std::condition_variable idle; // flush(): a slot became free
+    std::thread worker;
+};
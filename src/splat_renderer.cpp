@@ -0,0 +1,140 @@
+#include "splat_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "fastmath.h"
+#include "parallel.h"
+
+static constexpr int kLanes = 16;                 // pixels per row step; sprites are at most 13 wide
+static constexpr int kRowStride = SplatRenderer::kTile + kLanes; // lanes may spill into the padding
+static constexpr size_t kMinSpritesPerThread = 65536;
+// Squared sprite radii are >= 0, so their bit patterns order like their values;
+// masks and clamps on the bits keep float compares (branches) out of the lane loop
+static constexpr uint32_t kEdgeBits = 0x3e800000u;  // 0.25f: r = 0.5, particle.frag's discard
+static constexpr uint32_t kClampBits = 0x40deb852u; // 6.96f: keeps fastExp's argument >= -87
+
+void SplatRenderer::resize(int width, int height) {
+    w = std::max(width, 1);
+    h = std::max(height, 1);
+    tilesX = (w + kTile - 1) / kTile;
+    tilesY = (h + kTile - 1) / kTile;
+    image.assign((size_t)w * h * 3, 0);
+    bins.clear();
+}
+
+void SplatRenderer::render(const Particle* pts, size_t n, const SplatView& view) {
+    const size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    const size_t slices = std::max<size_t>(1, std::min(threads, n / kMinSpritesPerThread));
+    bins.resize(std::max(bins.size(), slices));
+    for (auto& b : bins) {
+        b.resize((size_t)tilesX * tilesY);
+        for (auto& t : b) t.clear();
+    }
+
+    // Bin: project each particle as particle.vert does and add it to every tile its square touches
+    const size_t per = (n + slices - 1) / slices;
+    parallelFor(slices, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            std::vector<std::vector<Sprite>>& mine = bins[s];
+            for (size_t i = s * per; i < std::min(n, (s + 1) * per); ++i) {
+                const glm::vec3 pos = pts[i].pos;
+                const glm::vec4 clip = view.viewProj * glm::vec4(pos, 1.0f);
+                // GL drops a point whose centre is clipped
+                if (!(clip.w > 0.0f) || std::fabs(clip.x) > clip.w || std::fabs(clip.y) > clip.w ||
+                    std::fabs(clip.z) > clip.w)
+                    continue;
+                const float x = (clip.x / clip.w + 1.0f) * 0.5f * (float)w;
+                const float y = (clip.y / clip.w + 1.0f) * 0.5f * (float)h;
+                const float dist = glm::length(view.camPos - pos);
+                const float size = glm::clamp(view.pointSize / (0.06f * dist + 1.0f), 1.0f, 12.0f);
+                glm::vec3 c = pts[i].color;
+                if (view.colorByRadius) {
+                    const float t = glm::clamp(glm::length(pos) / view.colorRadius, 0.0f, 1.0f);
+                    c = glm::mix(glm::vec3(1.0f, 0.85f, 0.6f), glm::vec3(0.35f, 0.55f, 1.0f), t);
+                }
+                c = glm::clamp(c, glm::vec3(0.0f), glm::vec3(1.0f)) * 255.0f + glm::vec3(0.5f);
+                const Sprite sp{x, y, size, (uint32_t)c.x | ((uint32_t)c.y << 8) | ((uint32_t)c.z << 16)};
+
+                const int tx0 = std::max(0, (int)((x - 0.5f * size) / kTile));
+                const int tx1 = std::min(tilesX - 1, (int)((x + 0.5f * size) / kTile));
+                const int ty0 = std::max(0, (int)((y - 0.5f * size) / kTile));
+                const int ty1 = std::min(tilesY - 1, (int)((y + 0.5f * size) / kTile));
+                for (int ty = ty0; ty <= ty1; ++ty)
+                    for (int tx = tx0; tx <= tx1; ++tx) mine[(size_t)ty * tilesX + tx].push_back(sp);
+            }
+        }
+    });
+
+    exposure = view.exposure;
+
+    // Raster: threads take tiles in turn (dense tiles take longer), each into its own HDR tile
+    nextTile = 0;
+    parallelFor(threads, 1, [&](size_t begin, size_t end) {
+        std::vector<float> accum(3 * (size_t)kRowStride * kTile);
+        for (size_t t = begin; t < end; ++t) {
+            for (int tile = nextTile++; tile < tilesX * tilesY; tile = nextTile++) rasterTile(tile, accum);
+        }
+    });
+}
+
+void SplatRenderer::rasterTile(int tile, std::vector<float>& accum) {
+    const int tx = tile % tilesX, ty = tile / tilesX;
+    const int ox = tx * kTile, oy = ty * kTile;
+    const int tw = std::min(kTile, w - ox), th = std::min(kTile, h - oy);
+    std::fill(accum.begin(), accum.end(), 0.0f);
+    float* accR = accum.data();
+    float* accG = accR + kRowStride * kTile;
+    float* accB = accG + kRowStride * kTile;
+
+    for (const auto& slice : bins) {
+        for (const Sprite& sp : slice[tile]) {
+            // Pixels whose centres fall inside the point's square, clipped to the tile
+            const float half = 0.5f * sp.size;
+            const int x0 = std::max(ox, (int)std::ceil(sp.x - half - 0.5f));
+            const int x1 = std::min(ox + tw - 1, (int)std::floor(sp.x + half - 0.5f));
+            const int y0 = std::max(oy, (int)std::ceil(sp.y - half - 0.5f));
+            const int y1 = std::min(oy + th - 1, (int)std::floor(sp.y + half - 0.5f));
+            if (x0 > x1 || y0 > y1) continue;
+            const int count = x1 - x0 + 1;
+            const float inv = 1.0f / sp.size;
+            const float cr = (float)(sp.color & 0xff) * (1.0f / 255.0f);
+            const float cg = (float)((sp.color >> 8) & 0xff) * (1.0f / 255.0f);
+            const float cb = (float)((sp.color >> 16) & 0xff) * (1.0f / 255.0f);
+
+            for (int py = y0; py <= y1; ++py) {
+                const float dy = ((float)py + 0.5f - sp.y) * inv;
+                const size_t row = (size_t)(py - oy) * kRowStride + (size_t)(x0 - ox);
+                float* r = accR + row;
+                float* g = accG + row;
+                float* b = accB + row;
+                // particle.frag: I = exp(-r^2 / (2 sigma^2)), sigma = 0.2, discard r > 0.5;
+                // blended colour = vColor * (0.6 + 0.4 I) * I * I
+                float weight[kLanes];
+                for (int k = 0; k < kLanes; ++k) {
+                    const float dx = ((float)(x0 + k) + 0.5f - sp.x) * inv;
+                    const uint32_t r2 = floatBits(dx * dx + dy * dy);
+                    const float intensity = fastExp(-12.5f * bitsFloat(std::min(r2, kClampBits)));
+                    const float wk = (0.6f + 0.4f * intensity) * intensity * intensity;
+                    const uint32_t keep = 0u - (uint32_t)((k < count) & (r2 <= kEdgeBits));
+                    weight[k] = bitsFloat(floatBits(wk) & keep);
+                }
+                for (int k = 0; k < kLanes; ++k) r[k] += cr * weight[k];
+                for (int k = 0; k < kLanes; ++k) g[k] += cg * weight[k];
+                for (int k = 0; k < kLanes; ++k) b[k] += cb * weight[k];
+            }
+        }
+    }
+
+    // Tonemap into the image (rows flipped: the image is stored top row first)
+    for (int py = 0; py < th; ++py) {
+        uint8_t* out = image.data() + ((size_t)(h - 1 - (oy + py)) * w + ox) * 3;
+        const size_t row = (size_t)py * kRowStride;
+        for (int px = 0; px < tw; ++px) {
+            out[3 * px + 0] = (uint8_t)(255.0f * (1.0f - fastExp(-std::min(exposure * accR[row + px], 87.0f))) + 0.5f);
+            out[3 * px + 1] = (uint8_t)(255.0f * (1.0f - fastExp(-std::min(exposure * accG[row + px], 87.0f))) + 0.5f);
+            out[3 * px + 2] = (uint8_t)(255.0f * (1.0f - fastExp(-std::min(exposure * accB[row + px], 87.0f))) + 0.5f);
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#include "tracers.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "parallel.h"
+
+// Tracers are converted to double in chunks of this size; the chunk's
+// scratch stays in cache while the sources stream past it.
+static constexpr size_t kTracerChunk = 1024;
+
+// Below this many tracers per thread, threading costs more than it saves
+static constexpr size_t kMinTracersPerThread = 16384;
+
+void tracerInit(TracerState& s, const std::vector<Particle>& pts, size_t nMassive, const TracerParams& params) {
+    const size_t nm = std::min(nMassive, pts.size());
+    s.params = params;
+    s.nMassive = nm;
+    s.massive.resize(nm);
+    s.vx.resize(nm); s.vy.resize(nm); s.vz.resize(nm);
+    s.ax.resize(nm); s.ay.resize(nm); s.az.resize(nm);
+    for (size_t i = 0; i < nm; ++i) {
+        s.massive.x[i] = pts[i].pos.x;
+        s.massive.y[i] = pts[i].pos.y;
+        s.massive.z[i] = pts[i].pos.z;
+        s.massive.gm[i] = params.gm * pts[i].mass;
+        s.vx[i] = pts[i].vel.x;
+        s.vy[i] = pts[i].vel.y;
+        s.vz[i] = pts[i].vel.z;
+    }
+}
+
+// Softened central-mass acceleration, written (not added) to ax/ay/az
+static void centralAccel(const double* x, const double* y, const double* z, size_t n,
+                         double mu, double eps2, double* ax, double* ay, double* az) {
+    for (size_t i = 0; i < n; ++i) {
+        double r2 = x[i] * x[i] + y[i] * y[i] + z[i] * z[i] + eps2;
+        double w = -mu / (r2 * std::sqrt(r2));
+        ax[i] = w * x[i];
+        ay[i] = w * y[i];
+        az[i] = w * z[i];
+    }
+}
+
+// Half drift, kick from central mass + sources at their mid-step positions, half drift
+static void stepTracerRange(const TracerState& s, Particle* p, size_t count, double dt) {
+    double tx[kTracerChunk], ty[kTracerChunk], tz[kTracerChunk];
+    double ax[kTracerChunk], ay[kTracerChunk], az[kTracerChunk];
+    const double h = 0.5 * dt;
+
+    for (size_t c0 = 0; c0 < count; c0 += kTracerChunk) {
+        const size_t nc = std::min(kTracerChunk, count - c0);
+        Particle* chunk = p + c0;
+        for (size_t i = 0; i < nc; ++i) {
+            tx[i] = chunk[i].pos.x + h * chunk[i].vel.x;
+            ty[i] = chunk[i].pos.y + h * chunk[i].vel.y;
+            tz[i] = chunk[i].pos.z + h * chunk[i].vel.z;
+        }
+        centralAccel(tx, ty, tz, nc, s.params.mu, s.params.eps2, ax, ay, az);
+        if (s.nMassive > 0)
+            accumulateGravity(s.massive, tx, ty, tz, nc, s.params.eps2, ax, ay, az);
+        for (size_t i = 0; i < nc; ++i) {
+            glm::vec3 v = chunk[i].vel + glm::vec3((float)(ax[i] * dt), (float)(ay[i] * dt), (float)(az[i] * dt));
+            chunk[i].vel = v;
+            chunk[i].pos = glm::vec3((float)(tx[i] + h * v.x), (float)(ty[i] + h * v.y), (float)(tz[i] + h * v.z));
+        }
+    }
+}
+
+void tracerBeginStep(TracerState& s, double dt) {
+    const size_t nm = s.nMassive;
+    const double h = 0.5 * dt;
+
+    // Sources: half drift to mid-step and compute their accelerations there
+    for (size_t i = 0; i < nm; ++i) {
+        s.massive.x[i] += h * s.vx[i];
+        s.massive.y[i] += h * s.vy[i];
+        s.massive.z[i] += h * s.vz[i];
+    }
+    centralAccel(s.massive.x.data(), s.massive.y.data(), s.massive.z.data(), nm,
+                 s.params.mu, s.params.eps2, s.ax.data(), s.ay.data(), s.az.data());
+    accumulateGravity(s.massive, s.massive.x.data(), s.massive.y.data(), s.massive.z.data(), nm,
+                      s.params.eps2, s.ax.data(), s.ay.data(), s.az.data());
+}
+
+void tracerStepSpan(const TracerState& s, Particle* tracers, size_t count, double dt) {
+    // Full DKD against the mid-step sources, in parallel slices
+    parallelFor(count, kMinTracersPerThread, [&](size_t b, size_t e) {
+        stepTracerRange(s, tracers + b, e - b, dt);
+    });
+}
+
+void tracerEndStep(TracerState& s, Particle* sources, double dt) {
+    const double h = 0.5 * dt;
+
+    // Sources: kick and second half drift, then publish to the particle array
+    for (size_t i = 0; i < s.nMassive; ++i) {
+        s.vx[i] += dt * s.ax[i];
+        s.vy[i] += dt * s.ay[i];
+        s.vz[i] += dt * s.az[i];
+        s.massive.x[i] += h * s.vx[i];
+        s.massive.y[i] += h * s.vy[i];
+        s.massive.z[i] += h * s.vz[i];
+        sources[i].pos = glm::vec3((float)s.massive.x[i], (float)s.massive.y[i], (float)s.massive.z[i]);
+        sources[i].vel = glm::vec3((float)s.vx[i], (float)s.vy[i], (float)s.vz[i]);
+    }
+}
+
+void tracerStep(TracerState& s, std::vector<Particle>& pts, double dt) {
+    const size_t nm = s.nMassive;
+    tracerBeginStep(s, dt);
+    if (pts.size() > nm) tracerStepSpan(s, pts.data() + nm, pts.size() - nm, dt);
+    tracerEndStep(s, pts.data(), dt);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include "gravity.h"
+#include "particle.h"
+
+// Test-particle mode: the particle array is split into
+//   [0, nMassive)        massive sources (attract everything, integrated in double)
+//   [nMassive, size())   massless tracers (feel forces, exert none)
+// Tracers see the central mass plus the sources, exactly like every particle
+// sees the central mass in stepParticles, so a step costs
+// O(Nm * (Nm + Nt)) instead of O(N^2). Tracers are independent of each other
+// and are updated in place, chunk by chunk, across all cores.
+struct TracerParams {
+    double mu   = 25.0;  // G * Mcentral
+    double gm   = 0.01;  // G per unit mass of the massive sources
+    double eps2 = 0.04;  // softening^2 (central and source forces)
+};
+
+struct TracerState {
+    TracerParams params;
+    size_t nMassive = 0;
+    BodyArrays massive;                // source positions + G*m (double)
+    std::vector<double> vx, vy, vz;    // source velocities
+    std::vector<double> ax, ay, az;    // source accelerations (scratch)
+};
+
+void tracerInit(TracerState& s, const std::vector<Particle>& pts, size_t nMassive, const TracerParams& params);
+// One drift-kick-drift leapfrog step for sources and tracers. Tracer state lives
+// in `pts` directly; source state is copied back into pts[0, nMassive).
+void tracerStep(TracerState& s, std::vector<Particle>& pts, double dt);
+
+// tracerStep in three phases, for tracers that are not in one array (e.g. the
+// tiles of an out-of-core store): begin moves the sources to mid-step, every
+// tracer span is then stepped against them, and end completes the sources and
+// writes them to sources[0, nMassive).
+void tracerBeginStep(TracerState& s, double dt);
+void tracerStepSpan(const TracerState& s, Particle* tracers, size_t count, double dt);
+void tracerEndStep(TracerState& s, Particle* sources, double dt);
@@ -0,0 +1,184 @@
+#include "trajectory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+bool TrajectoryRecorder::open(const char* path, const std::vector<uint64_t>& selection, size_t slots, size_t batch) {
+    close();
+    ids = selection;
+    frameBytes = trajectoryFrameBytes(ids.size());
+    ringFrames = slots < 2 ? 2 : slots;
+    batchFrames = batch < 1 ? 1 : (batch > ringFrames / 2 ? ringFrames / 2 : batch);
+    ring.assign(ringFrames * frameBytes, 0);
+    head = 0;
+    tail = 0;
+    droppedCount = 0;
+    stopping = false;
+
+    if (!file.openWrite(path, false)) return false;
+    TrajectoryHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, kTrajectoryMagic, sizeof(h.magic));
+    h.version = kTrajectoryVersion;
+    h.count = ids.size();
+    if (!file.writeAt(&h, sizeof(h), 0) ||
+        !file.writeAt(ids.data(), ids.size() * sizeof(uint64_t), sizeof(h))) {
+        std::cerr << "Failed to write trajectory header: " << path << std::endl;
+        file.close();
+        return false;
+    }
+    fileOffset = sizeof(h) + ids.size() * sizeof(uint64_t);
+    worker = std::thread([this] { run(); });
+    return true;
+}
+
+void TrajectoryRecorder::record(const Particle* pts, double time, uint64_t step) {
+    const uint64_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= ringFrames) {
+        ++droppedCount; // writer is a whole ring behind
+        return;
+    }
+
+    // Gather into the slot: time, step, positions, velocities
+    unsigned char* slot = ring.data() + (h % ringFrames) * frameBytes;
+    std::memcpy(slot, &time, sizeof(time));
+    std::memcpy(slot + sizeof(time), &step, sizeof(step));
+    float* pos = reinterpret_cast<float*>(slot + sizeof(time) + sizeof(step));
+    float* vel = pos + 3 * ids.size();
+    for (size_t k = 0; k < ids.size(); ++k) {
+        const Particle& p = pts[ids[k]];
+        pos[3 * k + 0] = p.pos.x;
+        pos[3 * k + 1] = p.pos.y;
+        pos[3 * k + 2] = p.pos.z;
+        vel[3 * k + 0] = p.vel.x;
+        vel[3 * k + 1] = p.vel.y;
+        vel[3 * k + 2] = p.vel.z;
+    }
+    head.store(h + 1, std::memory_order_release);
+
+    if ((h + 1) % batchFrames == 0) {
+        std::lock_guard<std::mutex> lock(mutex); // pairs with the writer's predicate check
+        wake.notify_one();
+    }
+}
+
+void TrajectoryRecorder::close() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+    file.sync();
+    file.close();
+    if (droppedCount > 0)
+        std::cerr << "Trajectory recorder dropped " << droppedCount << " frames (disk too slow)" << std::endl;
+}
+
+void TrajectoryRecorder::run() {
+    for (;;) {
+        bool stop;
+        {
+            // Wake for a full batch, on close, or periodically so slow runs still reach the disk
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(500), [this] {
+                return stopping || head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed) >= batchFrames;
+            });
+            stop = stopping;
+        }
+
+        const uint64_t t = tail.load(std::memory_order_relaxed);
+        const uint64_t h = head.load(std::memory_order_acquire);
+        // [t, h) in at most two contiguous pieces of the ring
+        for (uint64_t f = t; f < h;) {
+            const size_t slot = (size_t)(f % ringFrames);
+            const size_t n = (size_t)std::min<uint64_t>(h - f, ringFrames - slot);
+            if (!file.writeAt(ring.data() + slot * frameBytes, n * frameBytes, fileOffset))
+                std::cerr << "Trajectory write failed" << std::endl;
+            fileOffset += n * frameBytes;
+            f += n;
+        }
+        tail.store(h, std::memory_order_release);
+        if (stop) return;
+    }
+}
+
+const unsigned char* Trajectory::frame(size_t i) const {
+    return file.data + sizeof(TrajectoryHeader) + count * sizeof(uint64_t) + i * trajectoryFrameBytes(count);
+}
+
+double Trajectory::time(size_t i) const {
+    double t;
+    std::memcpy(&t, frame(i), sizeof(t));
+    return t;
+}
+
+uint64_t Trajectory::step(size_t i) const {
+    uint64_t s;
+    std::memcpy(&s, frame(i) + sizeof(double), sizeof(s));
+    return s;
+}
+
+const float* Trajectory::pos(size_t i) const {
+    return reinterpret_cast<const float*>(frame(i) + sizeof(double) + sizeof(uint64_t));
+}
+
+const float* Trajectory::vel(size_t i) const {
+    return pos(i) + 3 * count;
+}
+
+size_t Trajectory::frameAt(double t) const {
+    size_t lo = 0, hi = frames; // first frame with time > t is in [lo, hi]
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (time(mid) <= t) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo > 0 ? lo - 1 : 0;
+}
+
+bool openTrajectory(const char* path, Trajectory& traj) {
+    traj = Trajectory{};
+    if (!traj.file.open(path)) return false;
+    TrajectoryHeader h;
+    if (traj.file.size < sizeof(h)) {
+        std::cerr << "Not a trajectory file: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(&h, traj.file.data, sizeof(h));
+    const uint64_t idBytes = h.count * sizeof(uint64_t);
+    if (std::memcmp(h.magic, kTrajectoryMagic, sizeof(h.magic)) != 0 || h.version != kTrajectoryVersion ||
+        sizeof(h) + idBytes > traj.file.size) {
+        std::cerr << "Not a trajectory file: " << path << std::endl;
+        return false;
+    }
+    traj.count = (size_t)h.count;
+    traj.ids = reinterpret_cast<const uint64_t*>(traj.file.data + sizeof(h));
+    traj.frames = (size_t)((traj.file.size - sizeof(h) - idBytes) / trajectoryFrameBytes(traj.count));
+    return true;
+}
+
+std::vector<uint64_t> parseParticleSelection(const std::string& spec, size_t limit) {
+    std::vector<uint64_t> out;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        char* end = nullptr;
+        uint64_t first = std::strtoull(item.c_str(), &end, 10);
+        uint64_t last = first, stride = 1;
+        if (*end == '-') last = std::strtoull(end + 1, &end, 10);
+        if (*end == ':') stride = std::strtoull(end + 1, &end, 10);
+        if (*end != '\0' || stride == 0 || last < first) {
+            std::cerr << "Ignoring bad particle selection '" << item << "'" << std::endl;
+            continue;
+        }
+        for (uint64_t i = first; i <= last && i < limit; i += stride) out.push_back(i);
+    }
+    return out;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file_io.h"
+#include "mapped_file.h"
+#include "particle.h"
+
+// Trajectory file (.ntr), little-endian, append-only:
+//
+//   TrajectoryHeader
+//   uint64 ids[count]            particle indices being followed
+//   frame 0, frame 1, ...        one per recorded step, all the same size:
+//     double time, uint64 step, float3 pos[count], float3 vel[count]
+//
+// Frames are fixed size and time never decreases, so frame i is at a known
+// offset and the frame for a given time is a binary search away.
+
+static constexpr char kTrajectoryMagic[8] = {'N', 'B', 'T', 'R', 'A', 'J', '\0', '\0'};
+static constexpr uint32_t kTrajectoryVersion = 1;
+
+struct TrajectoryHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t count;       // particles per frame
+};
+
+// Bytes of one frame for `count` particles
+inline size_t trajectoryFrameBytes(size_t count) {
+    return sizeof(double) + sizeof(uint64_t) + 2 * count * 3 * sizeof(float);
+}
+
+// Records the selected particles every step.
+//
+// record() gathers the K selected positions and velocities into the next slot
+// of a preallocated ring and returns; a background thread appends filled
+// slots to the file in batches. Nothing on the stepping thread allocates or
+// touches the file. If the writer falls a whole ring behind, frames are
+// dropped (and counted) rather than stalling the simulation.
+class TrajectoryRecorder {
+public:
+    TrajectoryRecorder() = default;
+    ~TrajectoryRecorder() { close(); }
+    TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+    // Start a new file for `ids`; ringFrames slots, written batchFrames at a time
+    bool open(const char* path, const std::vector<uint64_t>& ids, size_t ringFrames = 1024, size_t batchFrames = 64);
+    void record(const Particle* pts, double time, uint64_t step);
+    void close(); // write what is buffered, then stop the writer
+
+    bool isOpen() const { return worker.joinable(); }
+    uint64_t dropped() const { return droppedCount; }
+
+private:
+    void run();
+
+    std::vector<uint64_t> ids;
+    size_t frameBytes = 0;
+    size_t ringFrames = 0;
+    size_t batchFrames = 0;
+    std::vector<unsigned char> ring;   // ringFrames * frameBytes
+    std::atomic<uint64_t> head{0};     // frames produced (stepping thread)
+    std::atomic<uint64_t> tail{0};     // frames written (writer thread)
+    uint64_t droppedCount = 0;
+
+    BlockFile file;
+    uint64_t fileOffset = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+};
+
+// Read access to a trajectory file; frames point into the mapping
+struct Trajectory {
+    MappedFile file;
+    size_t count = 0;     // particles per frame
+    size_t frames = 0;
+    const uint64_t* ids = nullptr;
+
+    double time(size_t frame) const;
+    uint64_t step(size_t frame) const;
+    const float* pos(size_t frame) const; // count x float3
+    const float* vel(size_t frame) const;
+    size_t frameAt(double t) const;       // last frame with time <= t (0 if none)
+
+private:
+    const unsigned char* frame(size_t i) const;
+};
+
+// Map a trajectory file; a partially written last frame is ignored
+bool openTrajectory(const char* path, Trajectory& traj);
+
+// Parse a particle selection such as "0-99,500,1000-1999:10" (ranges, with an
+// optional stride) into indices below `limit`
+std::vector<uint64_t> parseParticleSelection(const std::string& spec, size_t limit);
@@ -0,0 +1,77 @@
+#include "wisdom_holman.h"
+
+#include <algorithm>
+
+#include "kepler.h"
+
+void whInit(WHState& s, const std::vector<Particle>& pts, const WHParams& params) {
+    const size_t n = pts.size();
+    s.params = params;
+    s.bodies.resize(n);
+    s.vx.resize(n); s.vy.resize(n); s.vz.resize(n);
+    s.ax.resize(n); s.ay.resize(n); s.az.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Particle& p = pts[i];
+        s.bodies.x[i] = p.pos.x;
+        s.bodies.y[i] = p.pos.y;
+        s.bodies.z[i] = p.pos.z;
+        s.bodies.gm[i] = params.gm * p.mass;
+        s.vx[i] = p.vel.x;
+        s.vy[i] = p.vel.y;
+        s.vz[i] = p.vel.z;
+    }
+}
+
+// Interaction kick: mutual (softened) attraction between particles.
+// Skipped entirely for massless disks, where the map reduces to exact Kepler drift.
+static void whKick(WHState& s, double h) {
+    const size_t n = s.bodies.size();
+    if (s.params.gm == 0.0 || n == 0) return;
+    std::fill(s.ax.begin(), s.ax.end(), 0.0);
+    std::fill(s.ay.begin(), s.ay.end(), 0.0);
+    std::fill(s.az.begin(), s.az.end(), 0.0);
+    accumulateGravity(s.bodies, s.bodies.x.data(), s.bodies.y.data(), s.bodies.z.data(), n,
+                      s.params.eps2, s.ax.data(), s.ay.data(), s.az.data());
+    for (size_t i = 0; i < n; ++i) {
+        s.vx[i] += h * s.ax[i];
+        s.vy[i] += h * s.ay[i];
+        s.vz[i] += h * s.az[i];
+    }
+}
+
+// Jump: every heliocentric position shifts by the total particle momentum / Mcentral
+static void whJump(WHState& s, double h) {
+    const size_t n = s.bodies.size();
+    if (s.params.gm == 0.0 || n == 0) return;
+    double px = 0.0, py = 0.0, pz = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        px += s.bodies.gm[i] * s.vx[i];
+        py += s.bodies.gm[i] * s.vy[i];
+        pz += s.bodies.gm[i] * s.vz[i];
+    }
+    const double k = h / s.params.mu;
+    for (size_t i = 0; i < n; ++i) {
+        s.bodies.x[i] += k * px;
+        s.bodies.y[i] += k * py;
+        s.bodies.z[i] += k * pz;
+    }
+}
+
+void whStep(WHState& s, double dt) {
+    const double h = 0.5 * dt;
+    whKick(s, h);
+    whJump(s, h);
+    keplerDrift(s.bodies.x.data(), s.bodies.y.data(), s.bodies.z.data(),
+                s.vx.data(), s.vy.data(), s.vz.data(),
+                s.bodies.size(), s.params.mu, dt);
+    whJump(s, h);
+    whKick(s, h);
+}
+
+void whStore(const WHState& s, std::vector<Particle>& pts) {
+    const size_t n = std::min(pts.size(), s.bodies.size());
+    for (size_t i = 0; i < n; ++i) {
+        pts[i].pos = glm::vec3((float)s.bodies.x[i], (float)s.bodies.y[i], (float)s.bodies.z[i]);
+        pts[i].vel = glm::vec3((float)s.vx[i], (float)s.vy[i], (float)s.vz[i]);
+    }
+}
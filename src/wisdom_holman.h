@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include "gravity.h"
+#include "particle.h"
+
+// Wisdom-Holman symplectic map in democratic-heliocentric coordinates.
+// The Hamiltonian is split into Kepler motion about the central mass (solved
+// exactly), a kick from the particles' mutual attraction, and the "jump"
+// term that carries the central body's barycentric motion. Because the
+// dominant central force is integrated exactly, steps can be far longer than
+// the softened Euler update in stepParticles for the same accuracy.
+//
+// The central mass stays at the origin, so particle positions are already
+// heliocentric and their velocities are treated as barycentric.
+struct WHParams {
+    double mu   = 25.0;  // G * Mcentral (same as stepParticles)
+    double gm   = 0.0;   // G per unit particle mass; 0 = massless disk (pure Kepler)
+    double eps2 = 0.04;  // softening^2 for particle-particle forces only
+};
+
+// Double-precision shadow of the particle state. Kept between steps so that
+// round-off does not accumulate through the float Particle array.
+struct WHState {
+    WHParams params;
+    BodyArrays bodies;                // heliocentric positions + G*m
+    std::vector<double> vx, vy, vz;   // barycentric velocities
+    std::vector<double> ax, ay, az;   // scratch for the interaction kick
+};
+
+void whInit(WHState& s, const std::vector<Particle>& pts, const WHParams& params); // copy particles in
+void whStep(WHState& s, double dt);                                               // one K/2 J/2 D J/2 K/2 step
+void whStore(const WHState& s, std::vector<Particle>& pts);                        // copy positions/velocities out
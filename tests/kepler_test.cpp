@@ -0,0 +1,88 @@
+// Drifts bound and unbound two-body orbits over long steps with keplerDrift and
+// compares them against a finely stepped RK4 integration of the same orbits.
+// Returns non-zero if any orbit strays beyond the tolerance.
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "kepler.h"
+
+struct Orbit {
+    const char* name;
+    double x, y, z, vx, vy, vz;
+};
+
+// Reference: classic RK4 on r'' = -mu r / |r|^3
+static void referenceDrift(Orbit& o, double mu, double t, int steps) {
+    const double h = t / steps;
+    auto acc = [mu](const double* r, double* a) {
+        double d2 = r[0] * r[0] + r[1] * r[1] + r[2] * r[2];
+        double k = -mu / (d2 * std::sqrt(d2));
+        a[0] = k * r[0]; a[1] = k * r[1]; a[2] = k * r[2];
+    };
+    double r[3] = {o.x, o.y, o.z}, v[3] = {o.vx, o.vy, o.vz};
+    for (int s = 0; s < steps; ++s) {
+        double a1[3], a2[3], a3[3], a4[3], r2[3], r3[3], r4[3];
+        acc(r, a1);
+        for (int k = 0; k < 3; ++k) r2[k] = r[k] + 0.5 * h * v[k];
+        acc(r2, a2);
+        for (int k = 0; k < 3; ++k) r3[k] = r[k] + 0.5 * h * v[k] + 0.25 * h * h * a1[k];
+        acc(r3, a3);
+        for (int k = 0; k < 3; ++k) r4[k] = r[k] + h * v[k] + 0.5 * h * h * a2[k];
+        acc(r4, a4);
+        for (int k = 0; k < 3; ++k) {
+            // Runge-Kutta-Nystrom form of RK4 for second-order systems
+            r[k] += h * v[k] + h * h / 6.0 * (a1[k] + a2[k] + a3[k]);
+            v[k] += h / 6.0 * (a1[k] + 2.0 * a2[k] + 2.0 * a3[k] + a4[k]);
+        }
+    }
+    o.x = r[0]; o.y = r[1]; o.z = r[2];
+    o.vx = v[0]; o.vy = v[1]; o.vz = v[2];
+}
+
+int main() {
+    const double mu = 1.0;
+    // Mixed group: more than one lane group, so bound and unbound lanes share a solve
+    const std::vector<Orbit> start = {
+        {"hyperbolic e=1.5", 1.0, 0.0, 0.0, 0.0, std::sqrt(2.5), 0.0},
+        {"hyperbolic e=3", 1.0, 0.0, 0.0, 0.0, 2.0, 0.1},
+        {"fast hyperbolic", 1.0, 0.0, 0.0, 0.3, 5.0, 0.0},
+        {"hyperbolic outbound", 2.0, 1.0, 0.0, 1.2, 0.5, 0.0},
+        {"hyperbolic inbound", 5.0, 0.5, 0.0, -1.0, 0.0, 0.0},
+        {"near-parabolic", 1.0, 0.0, 0.0, 0.0, std::sqrt(2.0) * 1.0001, 0.0},
+        {"circular", 1.0, 0.0, 0.0, 0.0, 1.0, 0.0},
+        {"eccentric e=0.9", 1.0, 0.0, 0.0, 0.0, std::sqrt(1.9), 0.0},
+        {"inclined ellipse", 0.0, 1.5, 0.5, -0.6, 0.0, 0.3},
+        {"high eccentricity", 3.0, 0.0, 0.0, 0.05, 0.2, 0.0},
+    };
+
+    const double steps[] = {1.0, 7.3};
+    const int longSteps = 4;
+    int failures = 0;
+    for (double dt : steps) {
+        std::vector<double> x, y, z, vx, vy, vz;
+        for (const Orbit& o : start) {
+            x.push_back(o.x); y.push_back(o.y); z.push_back(o.z);
+            vx.push_back(o.vx); vy.push_back(o.vy); vz.push_back(o.vz);
+        }
+        for (int s = 0; s < longSteps; ++s)
+            keplerDrift(x.data(), y.data(), z.data(), vx.data(), vy.data(), vz.data(), x.size(), mu, dt);
+
+        for (size_t i = 0; i < start.size(); ++i) {
+            Orbit ref = start[i];
+            referenceDrift(ref, mu, dt * longSteps, 400000);
+            double dr = std::sqrt((x[i] - ref.x) * (x[i] - ref.x) + (y[i] - ref.y) * (y[i] - ref.y) +
+                                  (z[i] - ref.z) * (z[i] - ref.z));
+            double dv = std::sqrt((vx[i] - ref.vx) * (vx[i] - ref.vx) + (vy[i] - ref.vy) * (vy[i] - ref.vy) +
+                                  (vz[i] - ref.vz) * (vz[i] - ref.vz));
+            double rr = std::sqrt(ref.x * ref.x + ref.y * ref.y + ref.z * ref.z);
+            double vr = std::sqrt(ref.vx * ref.vx + ref.vy * ref.vy + ref.vz * ref.vz);
+            bool ok = std::isfinite(dr) && std::isfinite(dv) && dr <= 1e-9 * rr && dv <= 1e-9 * vr;
+            std::printf("%-4s dt=%-4g %-20s |dr|/r=%.2e |dv|/v=%.2e\n", ok ? "ok" : "FAIL", dt, start[i].name,
+                        dr / rr, dv / vr);
+            failures += ok ? 0 : 1;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
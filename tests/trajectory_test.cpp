@@ -0,0 +1,82 @@
+// Records frames of a few particles with TrajectoryRecorder, reopens the file
+// with openTrajectory and checks the ids, every recorded value, frameAt, and
+// that a partially written last frame is ignored. Returns non-zero on failure.
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "trajectory.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAIL %s\n", what);
+        ++failures;
+    }
+}
+
+int main() {
+    const std::string path = "trajectory_test.ntr";
+    const size_t n = 40, frames = 300;
+    const double dt = 0.01;
+
+    std::vector<uint64_t> ids = parseParticleSelection("0-9,20-38:3,39,400", n);
+    check(ids.size() == 18 && ids[10] == 20 && ids[16] == 38 && ids.back() == 39, "particle selection");
+
+    // Particle i at frame f: pos = (i, f, i * f), vel = (-i, -f, 0.5)
+    std::vector<Particle> pts(n);
+    TrajectoryRecorder recorder;
+    // The ring holds every frame, so none can be dropped however far the writer lags; batches of 16
+    check(recorder.open(path.c_str(), ids, 512, 16), "open recorder");
+    for (size_t f = 0; f < frames; ++f) {
+        for (size_t i = 0; i < n; ++i) {
+            pts[i].pos = glm::vec3((float)i, (float)f, (float)(i * f));
+            pts[i].vel = glm::vec3(-(float)i, -(float)f, 0.5f);
+        }
+        recorder.record(pts.data(), f * dt, 1000 + f);
+    }
+    recorder.close();
+    check(recorder.dropped() == 0, "no dropped frames");
+
+    // Half a frame of trailing bytes, as a crash mid-write would leave
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        std::vector<char> partial(trajectoryFrameBytes(ids.size()) / 2, 0x7f);
+        out.write(partial.data(), (std::streamsize)partial.size());
+    }
+
+    Trajectory traj;
+    check(openTrajectory(path.c_str(), traj), "open trajectory");
+    check(traj.count == ids.size(), "particle count");
+    check(traj.frames == frames, "frame count (partial last frame ignored)");
+    for (size_t k = 0; k < traj.count && k < ids.size(); ++k) check(traj.ids[k] == ids[k], "ids");
+
+    bool values = true;
+    for (size_t f = 0; f < traj.frames; ++f) {
+        values = values && traj.time(f) == f * dt && traj.step(f) == 1000 + f;
+        const float* p = traj.pos(f);
+        const float* v = traj.vel(f);
+        for (size_t k = 0; k < traj.count; ++k) {
+            const float i = (float)ids[k];
+            values = values && p[3 * k] == i && p[3 * k + 1] == (float)f && p[3 * k + 2] == (float)(ids[k] * f);
+            values = values && v[3 * k] == -i && v[3 * k + 1] == -(float)f && v[3 * k + 2] == 0.5f;
+        }
+    }
+    check(values, "recorded positions, velocities, times and steps");
+
+    // Last frame with time <= t
+    check(traj.frameAt(-1.0) == 0, "frameAt before the first frame");
+    check(traj.frameAt(0.0) == 0, "frameAt first frame");
+    check(traj.frameAt(0.555) == 55, "frameAt between frames");
+    check(traj.frameAt(100 * dt) == 100, "frameAt exact time");
+    check(traj.frameAt(1e9) == frames - 1, "frameAt after the last frame");
+
+    traj.file.close();
+    std::remove(path.c_str());
+    if (failures == 0) std::printf("ok   %zu frames of %zu particles\n", frames, ids.size());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+// Attach to a running simulation's live export (--live=NAME) and print, once a
+// second, how many frames arrived and a few statistics computed in place on
+// the newest one. An example consumer: it reads the shared ring zero-copy and
+// the simulation never waits for it.
+//
+//   NBodyLiveStat NAME [--seconds=N]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "live_export.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " NAME [--seconds=N]" << std::endl;
+        return 2;
+    }
+    double seconds = 0.0; // 0: until the simulation exits
+    for (int i = 2; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--seconds=", 10) == 0) seconds = std::strtod(argv[i] + 10, nullptr);
+        else std::cerr << "Ignoring unknown argument: " << argv[i] << std::endl;
+    }
+
+    LiveReader reader;
+    if (!reader.attach(argv[1])) return 1;
+
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t lastPublished = reader.published();
+    uint64_t torn = 0;
+    while (!reader.closed()) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        // Mass-weighted centre and rms radius of the newest frame, read in place
+        LiveFrame f;
+        double m = 0.0, cx = 0.0, cy = 0.0, cz = 0.0, r2 = 0.0;
+        bool ok = false;
+        for (int attempt = 0; attempt < 4 && !ok; ++attempt) {
+            if (!reader.acquire(f)) break;
+            m = cx = cy = cz = r2 = 0.0;
+            for (size_t i = 0; i < f.count; ++i) {
+                const double w = f.mass[i];
+                const double x = f.pos[3 * i], y = f.pos[3 * i + 1], z = f.pos[3 * i + 2];
+                m += w;
+                cx += w * x;
+                cy += w * y;
+                cz += w * z;
+                r2 += w * (x * x + y * y + z * z);
+            }
+            ok = reader.valid(f);
+            if (!ok) ++torn; // the writer lapped us mid-read: use the newer frame
+        }
+
+        const uint64_t published = reader.published();
+        std::cout << "frames/s " << (published - lastPublished);
+        if (ok && m > 0.0) {
+            cx /= m;
+            cy /= m;
+            cz /= m;
+            std::cout << "  step " << f.step << "  t " << f.time << "  N " << f.count << "  com (" << cx << ", " << cy
+                      << ", " << cz << ")  r_rms " << std::sqrt(std::max(0.0, r2 / m - (cx * cx + cy * cy + cz * cz)));
+        }
+        std::cout << "  retries " << torn << std::endl;
+        lastPublished = published;
+
+        if (seconds > 0.0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= seconds)
+            break;
+    }
+    return 0;
+}